@@ -0,0 +1,52 @@
+#include "block_owner_map.h"
+#include <iterator>
+
+void BlockOwnerMap::assign(uint64_t start, uint64_t length, uint32_t inode, uint64_t logical) {
+    if (length == 0) {
+        return;
+    }
+    const uint64_t end = start + length;
+
+    // An interval starting before the range loses the overlapping part, keeping any tail
+    auto it = intervals.lower_bound(start);
+    if (it != intervals.begin()) {
+        auto previous = std::prev(it);
+        if (previous->second.end > start) {
+            Interval tail = previous->second;
+            previous->second.end = start;
+            if (tail.end > end) {
+                intervals.emplace(end, Interval{tail.end, tail.inode, tail.logical + (end - previous->first)});
+            }
+        }
+    }
+
+    // Intervals starting inside the range are replaced, again keeping a tail past its end
+    it = intervals.lower_bound(start);
+    while (it != intervals.end() && it->first < end) {
+        if (it->second.end > end) {
+            Interval tail = it->second;
+            uint64_t tail_logical = tail.logical + (end - it->first);
+            intervals.erase(it);
+            intervals.emplace(end, Interval{tail.end, tail.inode, tail_logical});
+            break;
+        }
+        it = intervals.erase(it);
+    }
+
+    intervals.emplace(start, Interval{end, inode, logical});
+}
+
+bool BlockOwnerMap::lookup(uint64_t block, uint32_t& inode, uint64_t& logical) const {
+    // Last interval starting at or before block
+    auto it = intervals.upper_bound(block);
+    if (it == intervals.begin()) {
+        return false;
+    }
+    --it;
+    if (block >= it->second.end) {
+        return false;
+    }
+    inode = it->second.inode;
+    logical = it->second.logical + (block - it->first);
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef BLOCK_OWNER_MAP_H
+#define BLOCK_OWNER_MAP_H
+
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+// Reverse block map: fs block ranges to the inode that owns them, built from
+// the block maps of journaled inodes. Ranges never overlap; assigning a range
+// replaces whatever owned those blocks before, so the newest mapping wins.
+class BlockOwnerMap {
+private:
+    struct Interval {
+        uint64_t end;           // One past the last block
+        uint32_t inode;
+        uint64_t logical;       // File block of the first block (0 for extent/indirect blocks)
+    };
+
+    std::map<uint64_t, Interval> intervals;    // Keyed by first block
+
+public:
+    void assign(uint64_t start, uint64_t length, uint32_t inode, uint64_t logical);
+    bool lookup(uint64_t block, uint32_t& inode, uint64_t& logical) const;
+
+    size_t size() const { return intervals.size(); }
+    void clear() { intervals.clear(); }
+};
+
+#endif // BLOCK_OWNER_MAP_H
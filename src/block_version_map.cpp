@@ -0,0 +1,39 @@
+#include "block_version_map.h"
+#include "jbd2.h"
+#include <algorithm>
+
+void BlockVersionMap::add(uint64_t fs_block, const BlockCopy& copy) {
+    std::vector<BlockCopy>& copies = versions[fs_block];
+
+    // The live log arrives in order; only stale copies need to be slotted in
+    if (copies.empty() || !tidGreater(copies.back().sequence, copy.sequence)) {
+        copies.push_back(copy);
+    } else {
+        auto position = std::upper_bound(copies.begin(), copies.end(), copy.sequence,
+                                         [](uint32_t value, const BlockCopy& c) { return tidGreater(c.sequence, value); });
+        copies.insert(position, copy);
+    }
+    copy_count++;
+}
+
+bool BlockVersionMap::findAsOf(uint64_t fs_block, uint32_t sequence, BlockCopy& copy) const {
+    auto it = versions.find(fs_block);
+    if (it == versions.end()) {
+        return false;
+    }
+
+    // First copy after sequence; the one before it is in effect
+    const std::vector<BlockCopy>& copies = it->second;
+    auto after = std::upper_bound(copies.begin(), copies.end(), sequence,
+                                  [](uint32_t value, const BlockCopy& c) { return tidGreater(c.sequence, value); });
+    if (after == copies.begin()) {
+        return false;
+    }
+    copy = *(after - 1);
+    return true;
+}
+
+const std::vector<BlockCopy>* BlockVersionMap::find(uint64_t fs_block) const {
+    auto it = versions.find(fs_block);
+    return (it == versions.end()) ? nullptr : &it->second;
+}
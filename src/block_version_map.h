@@ -0,0 +1,40 @@
+#ifndef BLOCK_VERSION_MAP_H
+#define BLOCK_VERSION_MAP_H
+
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Journaled copy of an fs block, located by its log block
+struct BlockCopy {
+    uint32_t sequence;          // Transaction that journaled the copy
+    uint32_t journal_block;     // Log block holding the copy
+    bool escaped;               // JBD2_FLAG_ESCAPE: the leading magic was zeroed
+    bool stale;                 // Recovered outside the live log
+};
+
+// Per-block version index: every committed copy of each fs block, ordered by
+// transaction sequence, so the copy in effect after any transaction is one
+// binary search away.
+class BlockVersionMap {
+private:
+    std::unordered_map<uint64_t, std::vector<BlockCopy>> versions;
+    size_t copy_count = 0;
+
+public:
+    void add(uint64_t fs_block, const BlockCopy& copy);
+
+    // Newest copy journaled at or before sequence; false if there is none
+    bool findAsOf(uint64_t fs_block, uint32_t sequence, BlockCopy& copy) const;
+
+    // All copies of one fs block, oldest first (nullptr if never journaled)
+    const std::vector<BlockCopy>* find(uint64_t fs_block) const;
+    const std::unordered_map<uint64_t, std::vector<BlockCopy>>& getVersions() const { return versions; }
+
+    size_t blockCount() const { return versions.size(); }
+    size_t copyCount() const { return copy_count; }
+    void clear() { versions.clear(); copy_count = 0; }
+};
+
+#endif // BLOCK_VERSION_MAP_H
@@ -4,9 +4,9 @@
 #include <algorithm>
 
 const std::string CSVExporter::CSV_HEADER = 
-    "relative_time,transaction_seq,block_type,fs_block_num,operation_type,affected_inode,file_path,data_size,checksum,file_type,file_size,inode_number,link_count,filename,parent_dir_inode,change_type,full_path";
+    "relative_time,transaction_seq,block_type,fs_block_num,operation_type,affected_inode,file_path,data_size,checksum,file_type,file_size,inode_number,link_count,filename,parent_dir_inode,change_type,full_path,log_state,change_detail,revoked";
 
-CSVExporter::CSVExporter() : exported_count(0) {
+CSVExporter::CSVExporter() : path_trie(nullptr), exported_count(0) {
 }
 
 CSVExporter::~CSVExporter() {
@@ -149,7 +149,23 @@ std::string CSVExporter::formatCSVRow(const JournalTransaction& transaction) {
     
     // Phase 3 fields
     // full_path
-    ss << escapeCSVField(transaction.full_path);
+    std::string full_path;
+    if (path_trie) {
+        path_trie->appendPath(transaction.path_id, full_path);
+    }
+    ss << escapeCSVField(full_path) << ",";
+    
+    // Log walk fields
+    // log_state
+    ss << escapeCSVField(transaction.log_state) << ",";
+    
+    // Timeline fields
+    // change_detail
+    ss << escapeCSVField(transaction.change_detail) << ",";
+    
+    // Revocation fields
+    // revoked
+    ss << (transaction.revoked ? 1 : 0);
     
     return ss.str();
 }
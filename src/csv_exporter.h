@@ -10,6 +10,8 @@ class CSVExporter {
 private:
     static const std::string CSV_HEADER;
     
+    const PathTrie* path_trie;      // Resolves JournalTransaction::path_id
+    
     // Helper methods
     std::string escapeCSVField(const std::string& field);
     std::string formatCSVRow(const JournalTransaction& transaction);
@@ -19,6 +21,9 @@ public:
     CSVExporter();
     ~CSVExporter();
     
+    // Path trie of the parser that produced the rows; full_path is empty without one
+    void setPathTrie(const PathTrie* trie) { path_trie = trie; }
+    
     // Main export interface
     bool exportToCSV(const std::vector<JournalTransaction>& transactions,
                      const std::string& output_path,
@@ -0,0 +1,291 @@
+#include "directory_seed.h"
+#include "image_handler.h"
+#include "ext_filesystem.h"
+#include "journal_parser.h"
+#include "flat_hash.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char JVTREE_MAGIC[8] = {'J', 'V', 'T', 'R', 'E', 'E', 0, 0};
+
+static const uint32_t EXT4_ROOT_INODE = 2;
+static const uint8_t EXT4_FT_UNKNOWN = 0;
+static const uint8_t EXT4_FT_DIR = 2;
+static const uint16_t EXT4_S_IFMT = 0xF000;
+static const uint16_t EXT4_S_IFDIR = 0x4000;
+static const uint32_t EXT4_INLINE_DATA_FL = 0x10000000;
+
+DirectorySeed::DirectorySeed() : header(), entries(nullptr), names(nullptr), entry_count(0),
+                                 mapped_data(nullptr), mapped_size(0) {
+}
+
+DirectorySeed::~DirectorySeed() {
+    unmap();
+}
+
+void DirectorySeed::unmap() {
+    if (mapped_data) {
+        munmap(mapped_data, mapped_size);
+        mapped_data = nullptr;
+        mapped_size = 0;
+    }
+    entries = nullptr;
+    names = nullptr;
+    entry_count = 0;
+}
+
+static bool isDirectoryInode(const std::vector<char>& inode_data) {
+    uint16_t mode;
+    memcpy(&mode, inode_data.data(), 2);
+    return (mode & EXT4_S_IFMT) == EXT4_S_IFDIR;
+}
+
+// Record the entries of one directory and queue its subdirectories. The
+// directory's extents are read MAX_READ_BLOCKS at a time rather than block by
+// block; htree interior blocks look like a single empty entry and add nothing.
+bool DirectorySeed::walkDirectory(ImageHandler& image_handler, ExtFilesystem& filesystem, uint32_t dir_inode,
+                                  std::vector<uint32_t>& pending) {
+    const size_t I_BLOCK_OFFSET = 40;
+    const size_t I_BLOCK_SIZE = 60;
+
+    std::vector<char> inode_data;
+    if (!filesystem.readInode(image_handler, dir_inode, inode_data) || !isDirectoryInode(inode_data)) {
+        return false;
+    }
+
+    const uint32_t block_size = filesystem.getBlockSize();
+    auto parse_entries = [&](const char* data, size_t size) {
+        size_t pos = 0;
+        while (pos + 8 <= size) {
+            uint32_t entry_inode;
+            uint16_t raw_rec_len;
+            memcpy(&entry_inode, data + pos, 4);
+            memcpy(&raw_rec_len, data + pos + 4, 2);
+            uint32_t rec_len = ExtFilesystem::decodeRecLen(raw_rec_len, block_size);
+            uint8_t name_len = static_cast<uint8_t>(data[pos + 6]);
+            uint8_t file_type = static_cast<uint8_t>(data[pos + 7]);
+
+            if (rec_len < 8 || pos + rec_len > size) {
+                break;
+            }
+            const char* name = data + pos + 8;
+            bool dot = (name_len == 1 && name[0] == '.') || (name_len == 2 && name[0] == '.' && name[1] == '.');
+            if (entry_inode != 0 && entry_inode <= filesystem.getInodesCount() && name_len > 0 &&
+                8u + name_len <= rec_len && !dot) {
+                if (file_type == EXT4_FT_UNKNOWN) {
+                    // No filetype feature: only the inode says whether this is a directory
+                    std::vector<char> child;
+                    if (filesystem.readInode(image_handler, entry_inode, child) && isDirectoryInode(child)) {
+                        file_type = EXT4_FT_DIR;
+                    }
+                }
+
+                DirectorySeedEntry entry = DirectorySeedEntry();
+                entry.inode = entry_inode;
+                entry.parent_inode = dir_inode;
+                entry.name_offset = static_cast<uint32_t>(name_storage.size());
+                entry.name_length = name_len;
+                entry.file_type = file_type;
+                entry_storage.push_back(entry);
+                name_storage.append(name, name_len);
+
+                if (file_type == EXT4_FT_DIR) {
+                    pending.push_back(entry_inode);
+                }
+            }
+            pos += rec_len;
+        }
+    };
+
+    // Small directories may live in i_block: the parent inode, then entries
+    uint32_t flags;
+    memcpy(&flags, inode_data.data() + 32, 4);
+    if (flags & EXT4_INLINE_DATA_FL) {
+        parse_entries(inode_data.data() + I_BLOCK_OFFSET + 4, I_BLOCK_SIZE - 4);
+        return true;
+    }
+
+    std::vector<BlockExtent> extents;
+    if (!image_handler.mapInodeBlocks(inode_data.data(), extents)) {
+        return false;
+    }
+
+    std::vector<char> buffer;
+    for (const auto& extent : extents) {
+        if (extent.physical + extent.length > filesystem.getBlocksCount()) {
+            continue;
+        }
+        for (uint32_t done = 0; done < extent.length;) {
+            uint32_t count = std::min<uint32_t>(extent.length - done, MAX_READ_BLOCKS);
+            buffer.resize(static_cast<size_t>(count) * block_size);
+            long offset = static_cast<long>((extent.physical + done) * block_size);
+            if (image_handler.readBytes(offset, buffer.data(), buffer.size())) {
+                for (uint32_t i = 0; i < count; ++i) {
+                    parse_entries(buffer.data() + static_cast<size_t>(i) * block_size, block_size);
+                }
+            }
+            done += count;
+        }
+    }
+    return true;
+}
+
+bool DirectorySeed::build(ImageHandler& image_handler, ExtFilesystem& filesystem, const DirectorySeedKey& key) {
+    unmap();
+    entry_storage.clear();
+    name_storage.clear();
+
+    header = DirectorySeedFileHeader();
+    memcpy(header.magic, JVTREE_MAGIC, sizeof(header.magic));
+    header.version = SEED_VERSION;
+    header.superblock_fingerprint = key.superblock_fingerprint;
+    header.partition_offset = key.partition_offset;
+    header.overlay_sequence = key.overlay_sequence;
+
+    if (!filesystem.isLoaded()) {
+        std::cerr << "Error: Cannot walk the directory tree without a readable filesystem superblock" << std::endl;
+        return false;
+    }
+
+    // Breadth-first from the root; a directory reached twice (a corrupt or
+    // looping tree) is only walked once
+    FlatHashSet<uint32_t> walked;
+    std::vector<uint32_t> pending = {EXT4_ROOT_INODE};
+    for (size_t next = 0; next < pending.size(); ++next) {
+        uint32_t dir_inode = pending[next];
+        if (!walked.insert(dir_inode)) {
+            continue;
+        }
+        if (walkDirectory(image_handler, filesystem, dir_inode, pending)) {
+            header.directory_count++;
+        }
+        if (name_storage.size() > UINT32_MAX) {
+            std::cerr << "Error: Directory tree names exceed the .jvtree name section" << std::endl;
+            entry_storage.clear();
+            name_storage.clear();
+            return false;
+        }
+    }
+
+    if (header.directory_count == 0) {
+        std::cerr << "Error: Root directory is not readable, cannot seed the directory tree" << std::endl;
+        return false;
+    }
+
+    entries = entry_storage.data();
+    names = name_storage.data();
+    entry_count = entry_storage.size();
+    header.entry_count = entry_count;
+    header.names_size = name_storage.size();
+    header.entries_offset = sizeof(DirectorySeedFileHeader);
+    header.names_offset = header.entries_offset + entry_count * sizeof(DirectorySeedEntry);
+
+    std::cout << "Walked " << header.directory_count << " directories, " << entry_count
+              << " entries from the filesystem" << std::endl;
+    return true;
+}
+
+bool DirectorySeed::write(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot create directory tree file: " << path << std::endl;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries), entry_count * sizeof(DirectorySeedEntry));
+    file.write(names, header.names_size);
+
+    if (!file.good()) {
+        std::cerr << "Error: Failed writing directory tree file: " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote directory tree with " << entry_count << " entries to " << path << std::endl;
+    return true;
+}
+
+bool DirectorySeed::load(const std::string& path, const DirectorySeedKey& expected) {
+    unmap();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false; // No tree file yet
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(DirectorySeedFileHeader)) {
+        close(fd);
+        std::cerr << "Warning: Directory tree file " << path << " is truncated, rebuilding" << std::endl;
+        return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Warning: Cannot map directory tree file " << path << ", rebuilding" << std::endl;
+        return false;
+    }
+
+    mapped_data = data;
+    mapped_size = st.st_size;
+
+    const DirectorySeedFileHeader* file_header = static_cast<const DirectorySeedFileHeader*>(data);
+    if (memcmp(file_header->magic, JVTREE_MAGIC, sizeof(JVTREE_MAGIC)) != 0 ||
+        file_header->version != SEED_VERSION) {
+        std::cerr << "Warning: " << path << " is not a compatible directory tree file, rebuilding" << std::endl;
+        unmap();
+        return false;
+    }
+
+    if (file_header->superblock_fingerprint != expected.superblock_fingerprint ||
+        file_header->partition_offset != expected.partition_offset ||
+        file_header->overlay_sequence != expected.overlay_sequence) {
+        std::cerr << "Warning: Directory tree " << path << " was built for a different filesystem state, rebuilding"
+                  << std::endl;
+        unmap();
+        return false;
+    }
+
+    // Both sections must lie inside the file and every name inside the name section
+    bool valid = file_header->entries_offset <= mapped_size &&
+                 file_header->entry_count <= (mapped_size - file_header->entries_offset) / sizeof(DirectorySeedEntry) &&
+                 file_header->names_offset <= mapped_size &&
+                 file_header->names_size <= mapped_size - file_header->names_offset;
+    const char* base = static_cast<const char*>(data);
+    const DirectorySeedEntry* view = valid ? reinterpret_cast<const DirectorySeedEntry*>(base + file_header->entries_offset)
+                                           : nullptr;
+    for (uint64_t i = 0; valid && i < file_header->entry_count; ++i) {
+        valid = static_cast<uint64_t>(view[i].name_offset) + view[i].name_length <= file_header->names_size;
+    }
+    if (!valid) {
+        std::cerr << "Warning: Directory tree file " << path << " is corrupt, rebuilding" << std::endl;
+        unmap();
+        return false;
+    }
+
+    header = *file_header;
+    entries = view;
+    names = base + header.names_offset;
+    entry_count = header.entry_count;
+    entry_storage.clear();
+    name_storage.clear();
+    return true;
+}
+
+void DirectorySeed::apply(DirectoryTreeBuilder& tree, uint32_t sequence) const {
+    EXT4DirectoryEntry entry = EXT4DirectoryEntry();
+    for (size_t i = 0; i < entry_count; ++i) {
+        entry.inode = entries[i].inode;
+        entry.name_len = entries[i].name_length;
+        entry.file_type = entries[i].file_type;
+        entry.name.assign(names + entries[i].name_offset, entries[i].name_length);
+        tree.addDirectoryEntry(entries[i].parent_inode, entry, sequence);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef DIRECTORY_SEED_H
+#define DIRECTORY_SEED_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+class ImageHandler;
+class ExtFilesystem;
+class DirectoryTreeBuilder;
+
+// Identity of the filesystem state a seed was walked from
+struct DirectorySeedKey {
+    uint64_t superblock_fingerprint;    // ImageHandler::getSuperblockFingerprint()
+    int64_t partition_offset;           // Partition offset in bytes
+    uint32_t overlay_sequence;          // Through sequence of an attached replay overlay, 0 without one
+};
+
+// On-disk layout of a .jvtree file: the header, entry_count DirectorySeedEntry
+// records in walk order, then the names back to back. Fixed-size little-endian
+// records, so the file is used directly via mmap.
+struct DirectorySeedFileHeader {
+    char magic[8];                  // "JVTREE\0\0"
+    uint32_t version;
+    uint32_t overlay_sequence;
+    uint64_t superblock_fingerprint;
+    int64_t partition_offset;
+    uint64_t directory_count;       // Directories walked
+    uint64_t entry_count;
+    uint64_t entries_offset;
+    uint64_t names_size;
+    uint64_t names_offset;
+};
+
+// One directory entry found on disk: inode -> (parent, name)
+struct DirectorySeedEntry {
+    uint32_t inode;
+    uint32_t parent_inode;
+    uint32_t name_offset;           // Into the name section
+    uint8_t name_length;
+    uint8_t file_type;              // EXT4_FT_* of the entry (directories are 2)
+    uint16_t reserved;
+};
+
+// Names of the current on-disk directory tree, walked from the root inode
+// through the directory block maps. Seeds DirectoryTreeBuilder so inodes the
+// journal never names still resolve to a path, and persists as a .jvtree
+// file so later runs skip the walk.
+class DirectorySeed {
+private:
+    static const uint32_t SEED_VERSION = 1;
+    static constexpr uint32_t MAX_READ_BLOCKS = 256;   // Directory blocks read per request
+
+    DirectorySeedFileHeader header;
+
+    // Build-time storage
+    std::vector<DirectorySeedEntry> entry_storage;
+    std::string name_storage;
+
+    // Views used for seeding (either the storage above or the mapped file)
+    const DirectorySeedEntry* entries;
+    const char* names;
+    size_t entry_count;
+
+    void* mapped_data;
+    size_t mapped_size;
+
+    void unmap();
+    bool walkDirectory(ImageHandler& image_handler, ExtFilesystem& filesystem, uint32_t dir_inode,
+                       std::vector<uint32_t>& pending);
+
+public:
+    DirectorySeed();
+    ~DirectorySeed();
+
+    DirectorySeed(const DirectorySeed&) = delete;
+    DirectorySeed& operator=(const DirectorySeed&) = delete;
+
+    // Walk every directory reachable from the root inode
+    bool build(ImageHandler& image_handler, ExtFilesystem& filesystem, const DirectorySeedKey& key);
+    bool write(const std::string& path) const;
+
+    // Map a .jvtree file; false (with a warning) if it is missing, stale or corrupt
+    bool load(const std::string& path, const DirectorySeedKey& expected);
+
+    // Add every entry to the tree as the names in effect at sequence
+    void apply(DirectoryTreeBuilder& tree, uint32_t sequence) const;
+
+    size_t getEntryCount() const { return entry_count; }
+    uint64_t getDirectoryCount() const { return header.directory_count; }
+};
+
+#endif // DIRECTORY_SEED_H
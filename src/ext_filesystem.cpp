@@ -0,0 +1,402 @@
+#include "ext_filesystem.h"
+#include <iostream>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+ExtFilesystem::ExtFilesystem() : block_size(0), blocks_count(0), inodes_count(0), first_data_block(0),
+                                 blocks_per_group(0), inodes_per_group(0), inode_size(0), desc_size(32),
+                                 reserved_gdt_blocks(0), first_meta_bg(0), backup_groups{0, 0},
+                                 feature_compat(0), feature_incompat(0), feature_ro_compat(0),
+                                 group_count(0), loaded(false) {
+}
+
+bool ExtFilesystem::load(ImageHandler& image_handler) {
+    char superblock[1024];
+    if (!image_handler.readBytes(1024, superblock, sizeof(superblock))) {
+        std::cerr << "Error: Failed to read filesystem superblock" << std::endl;
+        return false;
+    }
+
+    uint16_t magic;
+    memcpy(&magic, superblock + 56, 2);
+    if (magic != 0xEF53) {
+        std::cerr << "Error: Invalid EXT filesystem magic number (got 0x" << std::hex << magic
+                  << std::dec << ")" << std::endl;
+        return false;
+    }
+
+    uint32_t log_block_size, blocks_lo;
+    memcpy(&inodes_count, superblock + 0, 4);
+    memcpy(&blocks_lo, superblock + 4, 4);
+    memcpy(&first_data_block, superblock + 20, 4);
+    memcpy(&log_block_size, superblock + 24, 4);
+    memcpy(&blocks_per_group, superblock + 32, 4);
+    memcpy(&inodes_per_group, superblock + 40, 4);
+    memcpy(&inode_size, superblock + 88, 2);
+    memcpy(&feature_compat, superblock + 92, 4);
+    memcpy(&feature_incompat, superblock + 96, 4);
+    memcpy(&feature_ro_compat, superblock + 100, 4);
+    memcpy(&reserved_gdt_blocks, superblock + 0xCE, 2);
+    memcpy(&first_meta_bg, superblock + 0x104, 4);
+    memcpy(backup_groups, superblock + 0x24C, 8);
+
+    if (log_block_size > 6 || inodes_per_group == 0 || blocks_per_group == 0) {
+        std::cerr << "Error: Unsupported filesystem geometry in superblock" << std::endl;
+        return false;
+    }
+
+    block_size = 1024u << log_block_size;
+    blocks_count = blocks_lo;
+    if (inode_size == 0) {
+        inode_size = 128; // Revision 0 filesystems
+    }
+    // Every inode number and block classification divides by the inodes per block
+    if (inode_size < 128 || inode_size > block_size || (inode_size & (inode_size - 1)) != 0) {
+        std::cerr << "Error: Unsupported inode size " << inode_size << " in superblock" << std::endl;
+        return false;
+    }
+
+    desc_size = 32;
+    if (feature_incompat & EXT4_FEATURE_INCOMPAT_64BIT) {
+        uint32_t blocks_hi;
+        uint16_t s_desc_size;
+        memcpy(&blocks_hi, superblock + 0x150, 4);
+        memcpy(&s_desc_size, superblock + 254, 2);
+        blocks_count |= static_cast<uint64_t>(blocks_hi) << 32;
+        if (s_desc_size >= 64) {
+            desc_size = s_desc_size;
+        }
+    }
+
+    if (blocks_count <= first_data_block) {
+        std::cerr << "Error: Unsupported filesystem geometry in superblock" << std::endl;
+        return false;
+    }
+    group_count = static_cast<uint32_t>((blocks_count - first_data_block + blocks_per_group - 1) / blocks_per_group);
+
+    image_handler.setFilesystemGeometry(block_size, blocks_count, first_data_block);
+
+    if (!loadGroupDescriptors(image_handler)) {
+        return false;
+    }
+    buildRegions();
+
+    loaded = true;
+    return true;
+}
+
+// Groups that carry a superblock (and GDT) backup
+bool ExtFilesystem::hasSuperblockBackup(uint32_t group) const {
+    if (group == 0) {
+        return true;
+    }
+    if (feature_compat & EXT4_FEATURE_COMPAT_SPARSE_SUPER2) {
+        return group == backup_groups[0] || group == backup_groups[1];
+    }
+    if (!(feature_ro_compat & EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER) || group == 1) {
+        return true;
+    }
+    if (group % 2 == 0) {
+        return false;
+    }
+    // Powers of 3, 5 and 7
+    for (uint32_t base : {3u, 5u, 7u}) {
+        uint64_t power = base;
+        while (power < group) {
+            power *= base;
+        }
+        if (power == group) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t ExtFilesystem::groupFirstBlock(uint32_t group) const {
+    return first_data_block + static_cast<uint64_t>(group) * blocks_per_group;
+}
+
+// Read the whole group descriptor table once. Without meta_bg it follows the
+// primary superblock; with meta_bg each metagroup keeps its descriptor block in
+// its own first group.
+bool ExtFilesystem::loadGroupDescriptors(ImageHandler& image_handler) {
+    const size_t max_read = 1024 * 1024;
+    uint32_t per_block = descriptorsPerBlock();
+    bool meta_bg = (feature_incompat & EXT4_FEATURE_INCOMPAT_META_BG) != 0;
+
+    groups.clear();
+    groups.reserve(group_count);
+
+    std::vector<char> table;
+    uint64_t table_start = 0;   // Index of the first group held in table
+
+    for (uint32_t group = 0; group < group_count; ++group) {
+        if (group == table_start + table.size() / desc_size) {
+            // Refill: a contiguous run of descriptors that starts at this group
+            uint32_t metagroup = group / per_block;
+            long offset;
+            size_t count;
+            if (!meta_bg || metagroup < first_meta_bg) {
+                uint32_t table_end = meta_bg ? first_meta_bg * per_block : group_count;
+                offset = static_cast<long>((first_data_block + 1) * block_size) + static_cast<long>(group) * desc_size;
+                count = std::min<size_t>(std::min<uint32_t>(table_end, group_count) - group, max_read / desc_size);
+            } else {
+                uint64_t first_group = static_cast<uint64_t>(metagroup) * per_block;
+                uint64_t block = groupFirstBlock(static_cast<uint32_t>(first_group)) +
+                                 (hasSuperblockBackup(static_cast<uint32_t>(first_group)) ? 1 : 0);
+                offset = static_cast<long>(block * block_size) + static_cast<long>(group - first_group) * desc_size;
+                count = std::min<size_t>(per_block - (group - first_group), group_count - group);
+            }
+
+            table.resize(count * desc_size);
+            table_start = group;
+            if (!image_handler.readBytes(offset, table.data(), table.size())) {
+                std::cerr << "Error: Failed to read group descriptors starting at group " << group << std::endl;
+                return false;
+            }
+        }
+
+        const char* desc = table.data() + (group - table_start) * desc_size;
+        uint32_t block_bitmap_lo, inode_bitmap_lo, inode_table_lo;
+        memcpy(&block_bitmap_lo, desc + 0, 4);
+        memcpy(&inode_bitmap_lo, desc + 4, 4);
+        memcpy(&inode_table_lo, desc + 8, 4);
+
+        GroupDescriptor gd = {block_bitmap_lo, inode_bitmap_lo, inode_table_lo};
+        if (desc_size >= 64) {
+            uint32_t block_bitmap_hi, inode_bitmap_hi, inode_table_hi;
+            memcpy(&block_bitmap_hi, desc + 0x20, 4);
+            memcpy(&inode_bitmap_hi, desc + 0x24, 4);
+            memcpy(&inode_table_hi, desc + 0x28, 4);
+            gd.block_bitmap |= static_cast<uint64_t>(block_bitmap_hi) << 32;
+            gd.inode_bitmap |= static_cast<uint64_t>(inode_bitmap_hi) << 32;
+            gd.inode_table |= static_cast<uint64_t>(inode_table_hi) << 32;
+        }
+        groups.push_back(gd);
+    }
+
+    return true;
+}
+
+// Record one metadata run; runs are sorted and merged by buildRegions()
+void ExtFilesystem::addRegion(uint64_t start, uint64_t length, FsRegionType type, uint32_t group, uint32_t first_inode) {
+    if (length == 0) {
+        return;
+    }
+    regions.push_back({start, length, type, group, first_inode});
+}
+
+void ExtFilesystem::buildRegions() {
+    regions.clear();
+
+    uint32_t per_block = descriptorsPerBlock();
+    bool meta_bg = (feature_incompat & EXT4_FEATURE_INCOMPAT_META_BG) != 0;
+    uint64_t gdt_blocks = meta_bg ? first_meta_bg
+                                  : (static_cast<uint64_t>(group_count) + per_block - 1) / per_block;
+    uint64_t inode_table_blocks = (static_cast<uint64_t>(inodes_per_group) * inode_size + block_size - 1) / block_size;
+
+    for (uint32_t group = 0; group < group_count; ++group) {
+        uint64_t block = groupFirstBlock(group);
+
+        if (hasSuperblockBackup(group)) {
+            // On 1K filesystems block 0 is the boot block and the superblock is block 1
+            addRegion(block, 1, FsRegionType::SUPERBLOCK, group, 0);
+            addRegion(block + 1, gdt_blocks, FsRegionType::GROUP_DESCRIPTORS, group, 0);
+            addRegion(block + 1 + gdt_blocks, reserved_gdt_blocks, FsRegionType::RESERVED_GDT, group, 0);
+        }
+
+        // meta_bg descriptor blocks live in the first, second and last group of each metagroup
+        if (meta_bg && group / per_block >= first_meta_bg) {
+            uint32_t index = group % per_block;
+            if (index == 0 || index == 1 || index == per_block - 1) {
+                addRegion(block + (hasSuperblockBackup(group) ? 1 : 0), 1, FsRegionType::GROUP_DESCRIPTORS, group, 0);
+            }
+        }
+
+        const GroupDescriptor& gd = groups[group];
+        addRegion(gd.block_bitmap, 1, FsRegionType::BLOCK_BITMAP, group, 0);
+        addRegion(gd.inode_bitmap, 1, FsRegionType::INODE_BITMAP, group, 0);
+        addRegion(gd.inode_table, inode_table_blocks, FsRegionType::INODE_TABLE, group,
+                  group * inodes_per_group + 1);
+    }
+
+    std::sort(regions.begin(), regions.end(),
+              [](const FsRegion& a, const FsRegion& b) { return a.start < b.start; });
+
+    // Merge runs that continue linearly (flex_bg packs consecutive groups' bitmaps and tables)
+    uint32_t inodes_per_block = block_size / inode_size;
+    std::vector<FsRegion> merged;
+    merged.reserve(regions.size());
+    for (const auto& region : regions) {
+        if (!merged.empty()) {
+            FsRegion& last = merged.back();
+            if (region.start < last.start + last.length) {
+                continue; // Overlap from a corrupt descriptor; keep the first claim
+            }
+            bool adjacent = (region.start == last.start + last.length && region.type == last.type);
+            bool linear = false;
+            if (adjacent) {
+                switch (region.type) {
+                    case FsRegionType::BLOCK_BITMAP:
+                    case FsRegionType::INODE_BITMAP:
+                        linear = (region.group == last.group + last.length);
+                        break;
+                    case FsRegionType::INODE_TABLE:
+                        linear = (region.first_inode == last.first_inode + last.length * inodes_per_block);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            if (linear) {
+                last.length += region.length;
+                continue;
+            }
+        }
+        merged.push_back(region);
+    }
+    regions.swap(merged);
+}
+
+BlockLocation ExtFilesystem::classifyBlock(uint64_t block) const {
+    BlockLocation location = {FsRegionType::DATA, 0, 0, 0};
+    if (!loaded || blocks_per_group == 0) {
+        return location;
+    }
+    location.group = static_cast<uint32_t>((block >= first_data_block ? block - first_data_block : 0) / blocks_per_group);
+
+    // Last region starting at or before block
+    auto it = std::upper_bound(regions.begin(), regions.end(), block,
+                               [](uint64_t value, const FsRegion& r) { return value < r.start; });
+    if (it == regions.begin()) {
+        return location;
+    }
+    --it;
+    if (block >= it->start + it->length) {
+        return location;
+    }
+
+    uint64_t index = block - it->start;
+    location.type = it->type;
+    switch (it->type) {
+        case FsRegionType::BLOCK_BITMAP:
+        case FsRegionType::INODE_BITMAP:
+            location.group = it->group + static_cast<uint32_t>(index);
+            break;
+        case FsRegionType::INODE_TABLE: {
+            uint32_t inodes_per_block = block_size / inode_size;
+            location.first_inode = it->first_inode + static_cast<uint32_t>(index * inodes_per_block);
+            location.inode_count = inodes_per_block;
+            location.group = (location.first_inode - 1) / inodes_per_group;
+            break;
+        }
+        default:
+            location.group = it->group;
+            break;
+    }
+    return location;
+}
+
+bool ExtFilesystem::locateInode(uint32_t inode, uint64_t& block, uint32_t& offset) const {
+    if (!loaded || inode == 0 || inode > inodes_count) {
+        return false;
+    }
+
+    uint32_t group = (inode - 1) / inodes_per_group;
+    uint32_t index = (inode - 1) % inodes_per_group;
+    if (group >= groups.size()) {
+        return false;
+    }
+
+    uint64_t byte_offset = static_cast<uint64_t>(index) * inode_size;
+    block = groups[group].inode_table + byte_offset / block_size;
+    offset = static_cast<uint32_t>(byte_offset % block_size);
+    return true;
+}
+
+bool ExtFilesystem::readInode(ImageHandler& image_handler, uint32_t inode, std::vector<char>& data) {
+    uint64_t block;
+    uint32_t offset;
+    if (!locateInode(inode, block, offset)) {
+        return false;
+    }
+
+    data.resize(inode_size);
+    return image_handler.readBytes(static_cast<long>(block * block_size + offset), data.data(), inode_size);
+}
+
+// Linear scan of every directory block; htree interior nodes look like empty
+// entries spanning the block, so leaf blocks are found the same way
+bool ExtFilesystem::findDirectoryEntry(ImageHandler& image_handler, uint32_t dir_inode, const std::string& name,
+                                       uint32_t& found_inode) {
+    const uint16_t EXT4_S_IFMT = 0xF000;
+    const uint16_t EXT4_S_IFDIR = 0x4000;
+
+    std::vector<char> inode_data;
+    if (!readInode(image_handler, dir_inode, inode_data)) {
+        return false;
+    }
+
+    uint16_t mode;
+    memcpy(&mode, inode_data.data(), 2);
+    if ((mode & EXT4_S_IFMT) != EXT4_S_IFDIR) {
+        return false;
+    }
+
+    std::vector<BlockExtent> extents;
+    if (!image_handler.mapInodeBlocks(inode_data.data(), extents)) {
+        return false;
+    }
+
+    std::vector<char> block(block_size);
+    for (const auto& extent : extents) {
+        for (uint32_t i = 0; i < extent.length; ++i) {
+            if (!image_handler.readBytes(static_cast<long>((extent.physical + i) * block_size), block.data(), block_size)) {
+                continue;
+            }
+
+            uint32_t pos = 0;
+            while (pos + 8 <= block_size) {
+                uint32_t entry_inode;
+                uint16_t raw_rec_len;
+                memcpy(&entry_inode, block.data() + pos, 4);
+                memcpy(&raw_rec_len, block.data() + pos + 4, 2);
+                uint32_t rec_len = decodeRecLen(raw_rec_len, block_size);
+                uint8_t name_len = static_cast<uint8_t>(block[pos + 6]);
+
+                if (rec_len < 8 || pos + rec_len > block_size) {
+                    break;
+                }
+                if (entry_inode != 0 && name_len == name.size() && 8u + name_len <= rec_len &&
+                    memcmp(block.data() + pos + 8, name.data(), name_len) == 0) {
+                    found_inode = entry_inode;
+                    return true;
+                }
+                pos += rec_len;
+            }
+        }
+    }
+    return false;
+}
+
+bool ExtFilesystem::lookupPath(ImageHandler& image_handler, const std::string& path, uint32_t& inode) {
+    if (!loaded || path.empty() || path[0] != '/') {
+        return false;
+    }
+
+    uint32_t current = EXT4_ROOT_INODE;
+    std::stringstream components(path);
+    std::string name;
+    while (std::getline(components, name, '/')) {
+        if (name.empty() || name == ".") {
+            continue;
+        }
+        if (!findDirectoryEntry(image_handler, current, name, current)) {
+            return false;
+        }
+    }
+
+    inode = current;
+    return true;
+}
@@ -0,0 +1,125 @@
+#ifndef EXT_FILESYSTEM_H
+#define EXT_FILESYSTEM_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "image_handler.h"
+
+// Kinds of fixed-location filesystem metadata
+enum class FsRegionType {
+    DATA,               // Anything outside the group metadata (files, directories, extent blocks)
+    SUPERBLOCK,         // Primary superblock or a backup
+    GROUP_DESCRIPTORS,  // Group descriptor table (or a meta_bg descriptor block)
+    RESERVED_GDT,       // Blocks reserved for online resize
+    BLOCK_BITMAP,
+    INODE_BITMAP,
+    INODE_TABLE
+};
+
+// A run of blocks of one metadata kind. Consecutive groups whose bitmaps or
+// inode tables are adjacent (flex_bg) share one region, since the group and
+// inode numbers still grow linearly across it.
+struct FsRegion {
+    uint64_t start;             // First fs block
+    uint64_t length;            // Number of blocks
+    FsRegionType type;
+    uint32_t group;             // Group of the first block
+    uint32_t first_inode;       // First inode in the region (inode tables only)
+};
+
+// Result of mapping one fs block onto the group layout
+struct BlockLocation {
+    FsRegionType type;
+    uint32_t group;             // Owning block group
+    uint32_t first_inode;       // First inode stored in the block (inode tables only)
+    uint32_t inode_count;       // Inodes stored in the block (inode tables only)
+};
+
+// Per-group metadata locations from the group descriptor table
+struct GroupDescriptor {
+    uint64_t block_bitmap;
+    uint64_t inode_bitmap;
+    uint64_t inode_table;
+};
+
+// On-disk view of the EXT filesystem the journal belongs to: the superblock,
+// the full group descriptor table and a sorted map of the metadata regions,
+// used to locate inodes, classify fs blocks and resolve paths.
+class ExtFilesystem {
+private:
+    static const uint32_t EXT4_ROOT_INODE = 2;
+    static const uint32_t EXT4_FEATURE_COMPAT_SPARSE_SUPER2 = 0x0200;
+    static const uint32_t EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER = 0x0001;
+    static const uint32_t EXT4_FEATURE_INCOMPAT_META_BG = 0x0010;
+    static const uint32_t EXT4_FEATURE_INCOMPAT_64BIT = 0x0080;
+
+    uint32_t block_size;
+    uint64_t blocks_count;
+    uint32_t inodes_count;
+    uint32_t first_data_block;
+    uint32_t blocks_per_group;
+    uint32_t inodes_per_group;
+    uint16_t inode_size;
+    uint16_t desc_size;             // Group descriptor size (32, or s_desc_size with 64bit)
+    uint16_t reserved_gdt_blocks;
+    uint32_t first_meta_bg;
+    uint32_t backup_groups[2];      // sparse_super2 backup groups
+    uint32_t feature_compat;
+    uint32_t feature_incompat;
+    uint32_t feature_ro_compat;
+    uint32_t group_count;
+    bool loaded;
+
+    std::vector<GroupDescriptor> groups;
+    std::vector<FsRegion> regions;  // Sorted by start block, non-overlapping
+
+    bool hasSuperblockBackup(uint32_t group) const;
+    uint64_t groupFirstBlock(uint32_t group) const;
+    uint32_t descriptorsPerBlock() const { return block_size / desc_size; }
+    bool loadGroupDescriptors(ImageHandler& image_handler);
+    void buildRegions();
+    void addRegion(uint64_t start, uint64_t length, FsRegionType type, uint32_t group, uint32_t first_inode);
+    bool findDirectoryEntry(ImageHandler& image_handler, uint32_t dir_inode, const std::string& name,
+                            uint32_t& found_inode);
+
+public:
+    ExtFilesystem();
+
+    bool load(ImageHandler& image_handler);
+    bool isLoaded() const { return loaded; }
+
+    // Inode location: fs block of its inode table slot and the byte offset within that block
+    bool locateInode(uint32_t inode, uint64_t& block, uint32_t& offset) const;
+    bool readInode(ImageHandler& image_handler, uint32_t inode, std::vector<char>& data);
+
+    // Resolve an absolute path on the current (on-disk) filesystem
+    bool lookupPath(ImageHandler& image_handler, const std::string& path, uint32_t& inode);
+
+    // Map an fs block onto the group layout in O(log regions)
+    BlockLocation classifyBlock(uint64_t block) const;
+
+    // Directory entry length; 64K blocks store 65536 as 0 or 0xFFFF with the high bits folded into the low two
+    static uint32_t decodeRecLen(uint16_t raw, uint32_t block_size) {
+        if (block_size < 65536) {
+            return raw;
+        }
+        if (raw == 0xFFFF || raw == 0) {
+            return block_size;
+        }
+        return (raw & 0xFFFC) | ((raw & 3u) << 16);
+    }
+
+    // Getters
+    uint32_t getBlockSize() const { return block_size; }
+    uint64_t getBlocksCount() const { return blocks_count; }
+    uint32_t getInodesCount() const { return inodes_count; }
+    uint32_t getInodesPerGroup() const { return inodes_per_group; }
+    uint32_t getBlocksPerGroup() const { return blocks_per_group; }
+    uint32_t getFirstDataBlock() const { return first_data_block; }
+    uint16_t getInodeSize() const { return inode_size; }
+    uint32_t getGroupCount() const { return group_count; }
+    const std::vector<FsRegion>& getRegions() const { return regions; }
+};
+
+#endif // EXT_FILESYSTEM_H
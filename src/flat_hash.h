@@ -0,0 +1,151 @@
+#ifndef FLAT_HASH_H
+#define FLAT_HASH_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+// Open-addressing hash map for integer keys. Entries live in one contiguous
+// slot array next to a byte array of tags (0 = empty, otherwise 0x80 | seven
+// hash bits), so a lookup is a linear probe that compares tags and only touches
+// a slot whose tag matches. There is no per-element allocation. Entries are
+// never erased; pointers returned by find() and operator[] stay valid until
+// the next insertion of a new key.
+template <typename Key, typename Value>
+class FlatHashMap {
+private:
+    struct Slot {
+        Key key;
+        Value value;
+    };
+
+    std::vector<uint8_t> tags;
+    std::vector<Slot> slots;
+    size_t count;
+
+    static uint64_t mix(uint64_t key) {
+        // splitmix64 finalizer: every key bit reaches both the index and the tag
+        key ^= key >> 30;
+        key *= 0xBF58476D1CE4E5B9ULL;
+        key ^= key >> 27;
+        key *= 0x94D049BB133111EBULL;
+        key ^= key >> 31;
+        return key;
+    }
+    static uint8_t tagOf(uint64_t hash) { return static_cast<uint8_t>(0x80 | (hash >> 57)); }
+
+    // Slot holding key, or the empty slot where it would go
+    size_t probe(const Key& key, uint64_t hash) const {
+        const size_t mask = tags.size() - 1;
+        const uint8_t tag = tagOf(hash);
+        size_t index = static_cast<size_t>(hash) & mask;
+        while (tags[index] != 0 && (tags[index] != tag || !(slots[index].key == key))) {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<uint8_t> old_tags;
+        std::vector<Slot> old_slots;
+        old_tags.swap(tags);
+        old_slots.swap(slots);
+        tags.assign(capacity, 0);
+        slots.resize(capacity);
+        for (size_t i = 0; i < old_tags.size(); ++i) {
+            if (old_tags[i] != 0) {
+                size_t index = probe(old_slots[i].key, mix(static_cast<uint64_t>(old_slots[i].key)));
+                tags[index] = old_tags[i];
+                slots[index] = std::move(old_slots[i]);
+            }
+        }
+    }
+
+public:
+    FlatHashMap() : count(0) {}
+
+    // Make room for n entries without rehashing; keeps the load at or below 3/4
+    void reserve(size_t n) {
+        size_t capacity = 16;
+        while (capacity - capacity / 4 < n) {
+            capacity *= 2;
+        }
+        if (capacity > tags.size()) {
+            rehash(capacity);
+        }
+    }
+
+    Value* find(const Key& key) {
+        if (count == 0) {
+            return nullptr;
+        }
+        size_t index = probe(key, mix(static_cast<uint64_t>(key)));
+        return tags[index] != 0 ? &slots[index].value : nullptr;
+    }
+    const Value* find(const Key& key) const {
+        if (count == 0) {
+            return nullptr;
+        }
+        size_t index = probe(key, mix(static_cast<uint64_t>(key)));
+        return tags[index] != 0 ? &slots[index].value : nullptr;
+    }
+    bool contains(const Key& key) const { return find(key) != nullptr; }
+
+    // Value for key, default-constructed if absent; second is true if it was inserted
+    std::pair<Value*, bool> tryEmplace(const Key& key) {
+        uint64_t hash = mix(static_cast<uint64_t>(key));
+        if (count > 0) {
+            size_t index = probe(key, hash);
+            if (tags[index] != 0) {
+                return {&slots[index].value, false};
+            }
+        }
+        reserve(count + 1);
+        size_t index = probe(key, hash);
+        tags[index] = tagOf(hash);
+        slots[index].key = key;
+        slots[index].value = Value();
+        count++;
+        return {&slots[index].value, true};
+    }
+    Value& operator[](const Key& key) { return *tryEmplace(key).first; }
+
+    // Visit every entry in slot order, which is unspecified
+    template <typename Function>
+    void forEach(Function function) const {
+        for (size_t i = 0; i < tags.size(); ++i) {
+            if (tags[i] != 0) {
+                function(slots[i].key, slots[i].value);
+            }
+        }
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() {
+        tags.clear();
+        slots.clear();
+        count = 0;
+    }
+};
+
+// Set counterpart of FlatHashMap
+template <typename Key>
+class FlatHashSet {
+private:
+    struct Empty {};
+    FlatHashMap<Key, Empty> map;
+
+public:
+    // True if key was not in the set yet
+    bool insert(const Key& key) { return map.tryEmplace(key).second; }
+    bool contains(const Key& key) const { return map.contains(key); }
+    void reserve(size_t n) { map.reserve(n); }
+
+    size_t size() const { return map.size(); }
+    bool empty() const { return map.empty(); }
+    void clear() { map.clear(); }
+};
+
+#endif // FLAT_HASH_H
@@ -1,11 +1,15 @@
 #include "image_handler.h"
+#include "journal_cache.h"
+#include "replay_overlay.h"
 #include <iostream>
 #include <cstring>
 #include <algorithm>
 #include <cstdio>
 #include <libewf.h>
 
-ImageHandler::ImageHandler() : ewf_handle(nullptr), current_type(ImageType::AUTO), partition_offset(0), verbose_mode(false) {
+ImageHandler::ImageHandler() : ewf_handle(nullptr), current_type(ImageType::AUTO), partition_offset(0), verbose_mode(false),
+                               fs_block_size(0), fs_blocks_count(0), fs_first_data_block(0), fs_inode_size(0),
+                               metadata_region_size(0), journal_inode_block_offset(0) {
     journal_location = {0, 0, false};
 }
 
@@ -120,6 +124,12 @@ void ImageHandler::setPartitionOffset(long offset) {
     }
 }
 
+void ImageHandler::setFilesystemGeometry(uint32_t block_size, uint64_t blocks_count, uint32_t first_data_block) {
+    fs_block_size = block_size;
+    fs_blocks_count = blocks_count;
+    fs_first_data_block = first_data_block;
+}
+
 bool ImageHandler::locateJournal(long manual_offset, long manual_size, bool verbose) {
     verbose_mode = verbose;
     if (manual_offset >= 0) {
@@ -128,6 +138,8 @@ bool ImageHandler::locateJournal(long manual_offset, long manual_size, bool verb
         journal_location.offset = manual_offset;
         journal_location.size = (manual_size > 0) ? manual_size : 0;
         journal_location.found = validateJournalMagic(manual_offset);
+        journal_extents.clear();
+        journal_map_blocks.clear();
         return journal_location.found;
     }
     
@@ -189,6 +201,23 @@ bool ImageHandler::findJournalInSuperblock() {
         return false;
     }
     
+    // Size of the boot block, superblock and group descriptor table
+    const uint32_t EXT4_FEATURE_INCOMPAT_64BIT = 0x0080;
+    uint64_t blocks_count = *reinterpret_cast<uint32_t*>(&superblock[4]);
+    if (*feature_incompat & EXT4_FEATURE_INCOMPAT_64BIT) {
+        blocks_count |= static_cast<uint64_t>(*reinterpret_cast<uint32_t*>(&superblock[0x150])) << 32;
+    }
+    uint32_t blocks_per_group = *reinterpret_cast<uint32_t*>(&superblock[32]);
+    uint16_t desc_size = *reinterpret_cast<uint16_t*>(&superblock[254]);
+    if (!(*feature_incompat & EXT4_FEATURE_INCOMPAT_64BIT) || desc_size < 32) {
+        desc_size = 32;
+    }
+    uint64_t group_count = (blocks_per_group > 0 && blocks_count > *first_data_block)
+        ? (blocks_count - *first_data_block + blocks_per_group - 1) / blocks_per_group : 1;
+    uint64_t gdt_blocks = (group_count * desc_size + block_size - 1) / block_size;
+    setFilesystemGeometry(block_size, blocks_count, *first_data_block);
+    metadata_region_size = static_cast<long>((*first_data_block + 1 + gdt_blocks) * block_size);
+    
     // Get inode table block number from group descriptor
     uint32_t* inode_table_block = reinterpret_cast<uint32_t*>(&group_desc[8]);
     long inode_table_offset = *inode_table_block * block_size;
@@ -196,11 +225,14 @@ bool ImageHandler::findJournalInSuperblock() {
     // Journal is at inode 8, each inode is typically 128 or 256 bytes
     uint16_t* inode_size = reinterpret_cast<uint16_t*>(&superblock[88]);
     uint16_t actual_inode_size = (*inode_size > 0) ? *inode_size : 128;
+    fs_inode_size = actual_inode_size;
     
     long journal_inode_offset = inode_table_offset + (8 - 1) * actual_inode_size; // inode 8 (0-based = 7)
+    journal_inode_block_offset = journal_inode_offset - journal_inode_offset % block_size;
     char journal_inode[256];
     
-    if (!readBytes(journal_inode_offset, journal_inode, actual_inode_size)) {
+    // The block map and size fields all sit in the first 128 bytes
+    if (!readBytes(journal_inode_offset, journal_inode, std::min<size_t>(actual_inode_size, sizeof(journal_inode)))) {
         std::cerr << "Error: Failed to read journal inode" << std::endl;
         return false;
     }
@@ -217,83 +249,32 @@ bool ImageHandler::findJournalInSuperblock() {
         }
     }
     
-    // Read journal size from inode (bytes 4-7: lower 32 bits of size)
+    // Read journal size from inode (bytes 4-7: lower 32 bits, 108-111: upper 32 bits)
     uint32_t* inode_size_lo = reinterpret_cast<uint32_t*>(&journal_inode[4]);
-    uint64_t journal_size = *inode_size_lo;
+    uint32_t* inode_size_hi = reinterpret_cast<uint32_t*>(&journal_inode[108]);
+    uint64_t journal_size = *inode_size_lo | (static_cast<uint64_t>(*inode_size_hi) << 32);
     
     if (verbose_mode) std::cout << "Debug: Journal size from inode = " << journal_size << " bytes" << std::endl;
     
-    // Check if inode uses extents (EXT4 feature)
-    uint32_t* inode_flags = reinterpret_cast<uint32_t*>(&journal_inode[32]);
-    const uint32_t EXT4_EXTENTS_FL = 0x00080000;
-    bool uses_extents = (*inode_flags & EXT4_EXTENTS_FL) != 0;
-    
-    if (verbose_mode) std::cout << "Debug: Inode flags = 0x" << std::hex << *inode_flags << std::dec 
-                  << (uses_extents ? " (uses extents)" : " (direct blocks)") << std::endl;
-    
-    uint32_t journal_block = 0;
+    // Map the journal inode's blocks; a journal is usually one extent but
+    // can be fragmented on filesystems that were grown or converted from ext3
+    std::vector<BlockExtent> extents;
+    std::vector<uint64_t> map_blocks;
+    if (!mapInodeBlocks(journal_inode, extents, &map_blocks)) {
+        std::cerr << "Error: Cannot decode journal inode block map" << std::endl;
+        return false;
+    }
     
-    if (uses_extents) {
-        // Parse extent header at offset 40
-        uint16_t* extent_magic = reinterpret_cast<uint16_t*>(&journal_inode[40]);
-        uint16_t* extent_entries = reinterpret_cast<uint16_t*>(&journal_inode[42]);
-        uint16_t* extent_max = reinterpret_cast<uint16_t*>(&journal_inode[44]);
-        uint16_t* extent_depth = reinterpret_cast<uint16_t*>(&journal_inode[46]);
-        
-        if (verbose_mode) std::cout << "Debug: Extent header - magic=0x" << std::hex << *extent_magic 
-                      << " entries=" << std::dec << *extent_entries 
-                      << " max=" << *extent_max << " depth=" << *extent_depth << std::endl;
-        
-        if (*extent_magic == 0xF30A && *extent_entries > 0) {
-            // Read first extent entry (starts at offset 48)
-            // EXT4 extent entry format: logical(4) + len(2) + start_hi(2) + start_lo(4)
-            uint32_t* extent_logical = reinterpret_cast<uint32_t*>(&journal_inode[48]);
-            uint16_t* extent_len = reinterpret_cast<uint16_t*>(&journal_inode[52]);
-            uint16_t* extent_start_hi = reinterpret_cast<uint16_t*>(&journal_inode[54]);
-            uint32_t* extent_start_lo = reinterpret_cast<uint32_t*>(&journal_inode[56]);
-            
-            if (verbose_mode) {
-                std::cout << "Debug: Raw extent bytes:" << std::endl;
-                for (int i = 48; i < 64; i++) {
-                    printf(" %02x", (unsigned char)journal_inode[i]);
-                }
-                std::cout << std::endl;
-            }
-            
-            // EXT4 extent entry format (12 bytes total):
-            // logical(4) + len(2) + start_hi(2) + start_lo(4)
-            // From hex dump: 00 00 00 00 00 00 00 00 00 40 00 00 00 00 04 00
-            // Bytes 48-51: logical = 0x00000000 = 0
-            // Bytes 52-53: len = 0x0000 = 0  
-            // Bytes 54-55: start_hi = 0x0000 = 0
-            // Bytes 56-59: start_lo = 0x00004000 = 16384
-            // Bytes 60-63: next extent = 0x00040000 = 262144
-            
-            // TSK shows 262144, which is at bytes 60-63, not 56-59
-            // So the start_lo field actually contains 16384, but TSK shows 262144
-            // This suggests there might be multiple extents or the parsing is wrong
-            
-            // Let's try reading as if the actual block start is at offset 60
-            uint32_t actual_start = *reinterpret_cast<uint32_t*>(&journal_inode[60]);
-            journal_block = actual_start;
-            
-            if (verbose_mode) std::cout << "Debug: Extent parsing - logical=" << *extent_logical 
-                      << " len=" << *extent_len 
-                      << " start_hi=" << *extent_start_hi
-                      << " start_lo=" << *extent_start_lo
-                      << " actual_start_at_60=" << actual_start
-                      << " calculated_block=" << journal_block << std::endl;
-        } else {
-            std::cerr << "Error: Invalid extent header magic (0x" << std::hex << *extent_magic << ")" << std::endl;
-            return false;
+    if (verbose_mode) {
+        std::cout << "Debug: Journal inode maps " << extents.size() << " extent(s)" << std::endl;
+        for (const auto& extent : extents) {
+            std::cout << "  logical " << extent.logical << " -> block " << extent.physical
+                      << " (" << extent.length << " blocks)" << std::endl;
         }
-    } else {
-        // Traditional direct block pointers
-        uint32_t* first_block = reinterpret_cast<uint32_t*>(&journal_inode[40]);
-        journal_block = *first_block;
-        if (verbose_mode) std::cout << "Debug: Direct block pointer = " << journal_block << std::endl;
     }
     
+    uint64_t journal_block = (!extents.empty() && extents.front().logical == 0) ? extents.front().physical : 0;
+    
     if (journal_block == 0) {
         std::cerr << "Error: Journal inode has no data blocks" << std::endl;
         return false;
@@ -307,6 +288,11 @@ bool ImageHandler::findJournalInSuperblock() {
         journal_location.offset = journal_offset;
         journal_location.size = journal_size; // Use size from inode
         journal_location.found = true;
+        journal_extents.swap(extents);
+        journal_map_blocks.swap(map_blocks);
+        if (journal_extents.size() > 1) {
+            std::cout << "Journal is fragmented into " << journal_extents.size() << " extents" << std::endl;
+        }
         std::cout << "Found journal at offset " << journal_offset << std::endl;
         return true;
     }
@@ -332,6 +318,8 @@ bool ImageHandler::findJournalInSuperblock() {
             journal_location.offset = search_offsets[i];
             journal_location.size = 0;
             journal_location.found = true;
+            journal_extents.clear();
+            journal_map_blocks.clear();
             std::cout << "Found journal at offset " << search_offsets[i] << std::endl;
             return true;
         }
@@ -388,6 +376,41 @@ bool ImageHandler::readBytes(long offset, char* buffer, size_t size) {
         return false;
     }
     
+    // Replayed blocks take precedence over the cache and the image
+    if (replay_overlay && replay_overlay->overlaps(offset, size)) {
+        return readOverlaidBytes(offset, buffer, size);
+    }
+    return readImageBytes(offset, buffer, size);
+}
+
+// Read a range that touches replayed blocks one block at a time
+bool ImageHandler::readOverlaidBytes(long offset, char* buffer, size_t size) {
+    const uint64_t block_size = replay_overlay->getBlockSize();
+    while (size > 0) {
+        uint64_t block = static_cast<uint64_t>(offset) / block_size;
+        size_t within = static_cast<size_t>(static_cast<uint64_t>(offset) % block_size);
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(size, block_size - within));
+        
+        if (!replay_overlay->readBlock(block, within, buffer, chunk) && !readImageBytes(offset, buffer, chunk)) {
+            return false;
+        }
+        
+        buffer += chunk;
+        offset += static_cast<long>(chunk);
+        size -= chunk;
+    }
+    return true;
+}
+
+// Read from the journal cache or the base image, ignoring any overlay
+bool ImageHandler::readImageBytes(long offset, char* buffer, size_t size) {
+    long adjusted_offset = offset + partition_offset;
+    
+    // Serve the journal and filesystem metadata from the local cache when attached
+    if (journal_cache && journal_cache->read(offset, buffer, size)) {
+        return true;
+    }
+    
     if (current_type == ImageType::RAW && raw_file) {
         raw_file->seekg(adjusted_offset);
         raw_file->read(buffer, size);
@@ -412,4 +435,337 @@ bool ImageHandler::readBytes(long offset, char* buffer, size_t size) {
 bool ImageHandler::readBlock(long block_number, char* buffer, size_t block_size) {
     long offset = block_number * block_size;
     return readBytes(offset, buffer, block_size);
+}
+
+// Read from the journal by its own byte offset, following the inode 8 block
+// map so that fragmented journals read correctly
+bool ImageHandler::readJournalBytes(long journal_offset, char* buffer, size_t size) {
+    if (journal_extents.empty()) {
+        return readBytes(journal_location.offset + journal_offset, buffer, size);
+    }
+    
+    while (size > 0) {
+        uint64_t logical = static_cast<uint64_t>(journal_offset) / fs_block_size;
+        uint64_t within = static_cast<uint64_t>(journal_offset) % fs_block_size;
+        
+        // Extents are sorted by logical block
+        auto it = std::upper_bound(journal_extents.begin(), journal_extents.end(), logical,
+                                   [](uint64_t value, const BlockExtent& e) { return value < e.logical; });
+        if (it == journal_extents.begin()) {
+            return false;
+        }
+        --it;
+        if (logical >= it->logical + it->length) {
+            return false; // Hole in the journal map
+        }
+        
+        uint64_t available = (it->logical + it->length - logical) * fs_block_size - within;
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(size, available));
+        long physical_offset = static_cast<long>((it->physical + (logical - it->logical)) * fs_block_size + within);
+        if (!readBytes(physical_offset, buffer, chunk)) {
+            return false;
+        }
+        
+        buffer += chunk;
+        journal_offset += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+// Append a run to an extent list, merging it with the previous run when contiguous
+static void appendExtent(std::vector<BlockExtent>& extents, uint64_t logical, uint64_t physical, uint32_t length) {
+    if (!extents.empty()) {
+        BlockExtent& last = extents.back();
+        if (last.logical + last.length == logical && last.physical + last.length == physical &&
+            static_cast<uint64_t>(last.length) + length <= UINT32_MAX) {
+            last.length += length;
+            return;
+        }
+    }
+    extents.push_back({logical, physical, length});
+}
+
+// Decode one extent tree node (the 60-byte i_block area or a full tree block).
+// Leaf nodes produce extents, index nodes produce the child blocks to visit.
+bool ImageHandler::decodeExtentNode(const char* node, size_t node_size, uint16_t& depth,
+                                    std::vector<BlockExtent>& leaves, std::vector<uint64_t>& children,
+                                    std::vector<uint64_t>* child_logicals) {
+    const uint16_t EXT4_EXT_MAGIC = 0xF30A;
+    const uint16_t EXT_INIT_MAX_LEN = 32768;
+    
+    if (node_size < 12) {
+        return false;
+    }
+    
+    uint16_t magic, entries;
+    memcpy(&magic, node, 2);
+    memcpy(&entries, node + 2, 2);
+    memcpy(&depth, node + 6, 2);
+    
+    if (magic != EXT4_EXT_MAGIC || entries > (node_size - 12) / 12) {
+        return false;
+    }
+    
+    for (uint16_t i = 0; i < entries; ++i) {
+        const char* entry = node + 12 + i * 12;
+        uint32_t first_logical;
+        memcpy(&first_logical, entry, 4);
+        
+        if (depth == 0) {
+            // ee_block(4) ee_len(2) ee_start_hi(2) ee_start_lo(4)
+            uint16_t len, start_hi;
+            uint32_t start_lo;
+            memcpy(&len, entry + 4, 2);
+            memcpy(&start_hi, entry + 6, 2);
+            memcpy(&start_lo, entry + 8, 4);
+            if (len > EXT_INIT_MAX_LEN) {
+                len -= EXT_INIT_MAX_LEN; // Unwritten extent
+            }
+            if (len > 0) {
+                leaves.push_back({first_logical, (static_cast<uint64_t>(start_hi) << 32) | start_lo, len});
+            }
+        } else {
+            // ei_block(4) ei_leaf_lo(4) ei_leaf_hi(2) ei_unused(2)
+            uint32_t leaf_lo;
+            uint16_t leaf_hi;
+            memcpy(&leaf_lo, entry + 4, 4);
+            memcpy(&leaf_hi, entry + 8, 2);
+            children.push_back((static_cast<uint64_t>(leaf_hi) << 32) | leaf_lo);
+            if (child_logicals) {
+                child_logicals->push_back(first_logical);
+            }
+        }
+    }
+    return true;
+}
+
+// Whether a run of block pointers lies inside the filesystem. Damaged
+// evidence can point anywhere; following such a pointer reads past the end of
+// the image or, through an indirect block, millions of garbage blocks.
+bool ImageHandler::isFilesystemBlock(uint64_t block, uint64_t length) const {
+    if (block < fs_first_data_block) {
+        return false;
+    }
+    return fs_blocks_count == 0 || (block < fs_blocks_count && length <= fs_blocks_count - block);
+}
+
+bool ImageHandler::mapExtentNode(const char* node, size_t node_size, int depth_limit, uint64_t logical_limit,
+                                 std::vector<BlockExtent>& extents, std::vector<uint64_t>* map_blocks) {
+    uint16_t depth = 0;
+    std::vector<BlockExtent> leaves;
+    std::vector<uint64_t> children;
+    std::vector<uint64_t> child_logicals;
+    if (!decodeExtentNode(node, node_size, depth, leaves, children, &child_logicals)) {
+        std::cerr << "Error: Invalid extent tree node" << std::endl;
+        return false;
+    }
+    
+    for (const auto& leaf : leaves) {
+        // Blocks past i_size are preallocated at most; only map what the file holds
+        if (leaf.logical >= logical_limit) {
+            continue;
+        }
+        if (!isFilesystemBlock(leaf.physical, leaf.length)) {
+            std::cerr << "Error: Extent points outside the filesystem (block " << leaf.physical << ")" << std::endl;
+            return false;
+        }
+        uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(leaf.length, logical_limit - leaf.logical));
+        appendExtent(extents, leaf.logical, leaf.physical, length);
+    }
+    if (children.empty()) {
+        return true;
+    }
+    
+    // ext4 limits trees to a depth of 5
+    if (depth_limit <= 0) {
+        std::cerr << "Error: Extent tree is deeper than supported" << std::endl;
+        return false;
+    }
+    
+    std::vector<char> child(fs_block_size);
+    for (size_t i = 0; i < children.size(); ++i) {
+        // Index entries are sorted, so no later child covers blocks below i_size either
+        if (child_logicals[i] >= logical_limit) {
+            break;
+        }
+        uint64_t block = children[i];
+        if (!isFilesystemBlock(block)) {
+            std::cerr << "Error: Extent tree block " << block << " is outside the filesystem" << std::endl;
+            return false;
+        }
+        if (!readBytes(static_cast<long>(block * fs_block_size), child.data(), fs_block_size)) {
+            std::cerr << "Error: Failed to read extent tree block " << block << std::endl;
+            return false;
+        }
+        if (map_blocks) {
+            map_blocks->push_back(block);
+        }
+        if (!mapExtentNode(child.data(), fs_block_size, depth_limit - 1, logical_limit, extents, map_blocks)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Map one ext2/3 block pointer; level 0 is a data block, 1-3 are the
+// single, double and triple indirect blocks. Stops once logical reaches
+// logical_limit, the block count implied by i_size.
+bool ImageHandler::mapIndirectBlock(uint64_t block, int level, uint64_t& logical, uint64_t logical_limit,
+                                    std::vector<BlockExtent>& extents, std::vector<uint64_t>* map_blocks) {
+    uint64_t pointers_per_block = fs_block_size / 4;
+    
+    if (logical >= logical_limit) {
+        return true;
+    }
+    
+    if (block == 0) {
+        // Sparse hole: skip every block this pointer would have covered
+        uint64_t span = 1;
+        for (int i = 0; i < level; ++i) {
+            span *= pointers_per_block;
+        }
+        logical += span;
+        return true;
+    }
+    
+    if (!isFilesystemBlock(block)) {
+        std::cerr << "Error: Block pointer " << block << " is outside the filesystem" << std::endl;
+        return false;
+    }
+    
+    if (level == 0) {
+        appendExtent(extents, logical, block, 1);
+        ++logical;
+        return true;
+    }
+    
+    std::vector<char> pointers(fs_block_size);
+    if (!readBytes(static_cast<long>(block * fs_block_size), pointers.data(), fs_block_size)) {
+        std::cerr << "Error: Failed to read indirect block " << block << std::endl;
+        return false;
+    }
+    if (map_blocks) {
+        map_blocks->push_back(block);
+    }
+    
+    for (uint64_t i = 0; i < pointers_per_block && logical < logical_limit; ++i) {
+        uint32_t child;
+        memcpy(&child, pointers.data() + i * 4, 4);
+        if (!mapIndirectBlock(child, level - 1, logical, logical_limit, extents, map_blocks)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ImageHandler::mapInodeBlocks(const char* inode_data, std::vector<BlockExtent>& extents,
+                                  std::vector<uint64_t>* map_blocks) {
+    const uint32_t EXT4_EXTENTS_FL = 0x00080000;
+    const size_t I_BLOCK_OFFSET = 40;
+    const size_t I_BLOCK_SIZE = 60;
+    
+    if (fs_block_size == 0) {
+        return false;
+    }
+    
+    uint32_t flags, size_lo, size_hi;
+    memcpy(&flags, inode_data + 32, 4);
+    memcpy(&size_lo, inode_data + 4, 4);
+    memcpy(&size_hi, inode_data + 108, 4);
+    
+    // Blocks the file can hold: ceil(i_size / block size)
+    uint64_t size = size_lo | (static_cast<uint64_t>(size_hi) << 32);
+    uint64_t logical_limit = size / fs_block_size + (size % fs_block_size != 0 ? 1 : 0);
+    
+    if (flags & EXT4_EXTENTS_FL) {
+        return mapExtentNode(inode_data + I_BLOCK_OFFSET, I_BLOCK_SIZE, 5, logical_limit, extents, map_blocks);
+    }
+    
+    // 12 direct pointers followed by single, double and triple indirect
+    uint64_t logical = 0;
+    for (int i = 0; i < 15 && logical < logical_limit; ++i) {
+        uint32_t block;
+        memcpy(&block, inode_data + I_BLOCK_OFFSET + i * 4, 4);
+        int level = (i < 12) ? 0 : i - 11;
+        if (!mapIndirectBlock(block, level, logical, logical_limit, extents, map_blocks)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ImageHandler::createJournalCache(const std::string& path) {
+    if (!journal_location.found) {
+        std::cerr << "Error: Cannot create journal cache before the journal is located" << std::endl;
+        return false;
+    }
+    return JournalCache::create(*this, path);
+}
+
+bool ImageHandler::attachJournalCache(const std::string& path) {
+    // Validate against the image itself, not a previously attached cache
+    journal_cache.reset();
+    
+    std::unique_ptr<JournalCache> cache = std::make_unique<JournalCache>();
+    if (!cache->open(path, getSuperblockFingerprint(), partition_offset)) {
+        return false;
+    }
+    journal_cache = std::move(cache);
+    return true;
+}
+
+bool ImageHandler::attachOverlay(const std::string& path) {
+    // Validate against the base image, not a previously attached overlay
+    replay_overlay.reset();
+    
+    std::unique_ptr<ReplayOverlay> overlay = std::make_unique<ReplayOverlay>();
+    if (!overlay->open(path, getSuperblockFingerprint(), partition_offset)) {
+        return false;
+    }
+    replay_overlay = std::move(overlay);
+    return true;
+}
+
+uint32_t ImageHandler::getOverlaySequence() const {
+    return replay_overlay ? replay_overlay->getThroughSequence() : 0;
+}
+
+// FNV-1a over the ext superblock and the journal superblock. Hashing the whole
+// image is impractical for multi-terabyte evidence, but these blocks carry the
+// filesystem UUID, mount/write times and the journal's sequence state, so any
+// change to the journal is reflected here.
+static void fingerprintMix(uint64_t& hash, const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+}
+
+uint64_t ImageHandler::getImageFingerprint() {
+    const size_t chunk_size = 1024;
+    char buffer[chunk_size];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    
+    if (readBytes(1024, buffer, chunk_size)) {
+        fingerprintMix(hash, buffer, chunk_size);
+    }
+    if (journal_location.found && readJournalBytes(0, buffer, chunk_size)) {
+        fingerprintMix(hash, buffer, chunk_size);
+    }
+    
+    return hash;
+}
+
+// FNV-1a over the ext superblock alone, usable before the journal is located.
+// Sidecar files describe the base image, so a replayed superblock is skipped.
+uint64_t ImageHandler::getSuperblockFingerprint() {
+    const size_t chunk_size = 1024;
+    char buffer[chunk_size];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    
+    if (readImageBytes(1024, buffer, chunk_size)) {
+        fingerprintMix(hash, buffer, chunk_size);
+    }
+    return hash;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <string>
 #include <memory>
 #include <fstream>
+#include <cstdint>
+#include <vector>
 
 enum class ImageType {
     AUTO,
@@ -11,6 +13,16 @@ enum class ImageType {
     EWF
 };
 
+// Run of contiguous filesystem blocks in an inode's block map
+struct BlockExtent {
+    uint64_t logical;    // First logical block within the file
+    uint64_t physical;   // First filesystem block on disk
+    uint32_t length;     // Number of blocks
+};
+
+class JournalCache;
+class ReplayOverlay;
+
 struct JournalLocation {
     long offset;
     long size;
@@ -27,12 +39,31 @@ private:
     long partition_offset;
     bool verbose_mode;
     
+    // Filesystem layout recorded while locating the journal
+    uint32_t fs_block_size;
+    uint64_t fs_blocks_count;                   // s_blocks_count, 0 until a superblock is read
+    uint32_t fs_first_data_block;               // s_first_data_block
+    uint16_t fs_inode_size;                     // s_inode_size
+    long metadata_region_size;                  // Boot block, superblock and group descriptor table
+    long journal_inode_block_offset;            // Inode table block holding inode 8
+    std::vector<BlockExtent> journal_extents;   // Inode 8 block map, empty for a contiguous journal
+    std::vector<uint64_t> journal_map_blocks;   // Extent index / indirect blocks of inode 8
+    
+    std::unique_ptr<JournalCache> journal_cache;
+    std::unique_ptr<ReplayOverlay> replay_overlay;
+    
     // Helper methods
     ImageType detectImageType(const std::string& path);
     bool openRawImage(const std::string& path);
     bool openEWFImage(const std::string& path);
     bool findJournalInSuperblock();
     bool validateJournalMagic(long offset);
+    bool readOverlaidBytes(long offset, char* buffer, size_t size);
+    bool isFilesystemBlock(uint64_t block, uint64_t length = 1) const;
+    bool mapExtentNode(const char* node, size_t node_size, int depth_limit, uint64_t logical_limit,
+                       std::vector<BlockExtent>& extents, std::vector<uint64_t>* map_blocks);
+    bool mapIndirectBlock(uint64_t block, int level, uint64_t& logical, uint64_t logical_limit,
+                          std::vector<BlockExtent>& extents, std::vector<uint64_t>* map_blocks);
 
 public:
     ImageHandler();
@@ -41,11 +72,36 @@ public:
     // Main interface methods
     bool openImage(const std::string& path, const std::string& type_str = "auto");
     void setPartitionOffset(long offset);
+    void setFilesystemGeometry(uint32_t block_size, uint64_t blocks_count, uint32_t first_data_block);
     bool locateJournal(long manual_offset = -1, long manual_size = -1, bool verbose = false);
     
     // Data reading methods
     bool readBytes(long offset, char* buffer, size_t size);
+    bool readImageBytes(long offset, char* buffer, size_t size);            // Bypasses any overlay
     bool readBlock(long block_number, char* buffer, size_t block_size = 4096);
+    bool readJournalBytes(long journal_offset, char* buffer, size_t size);  // Offset within the journal
+    
+    // Block map of an inode (extent tree or ext2/3 indirect blocks), up to i_size;
+    // fails on a pointer outside the filesystem
+    bool mapInodeBlocks(const char* inode_data, std::vector<BlockExtent>& extents,
+                        std::vector<uint64_t>* map_blocks = nullptr);
+    static bool decodeExtentNode(const char* node, size_t node_size, uint16_t& depth,
+                                 std::vector<BlockExtent>& leaves, std::vector<uint64_t>& children,
+                                 std::vector<uint64_t>* child_logicals = nullptr);
+    
+    // Local copy of the journal and filesystem metadata (see JournalCache)
+    bool createJournalCache(const std::string& path);
+    bool attachJournalCache(const std::string& path);
+    bool isJournalCacheAttached() const { return journal_cache != nullptr; }
+    
+    // Replayed fs blocks served over the base image (see ReplayOverlay)
+    bool attachOverlay(const std::string& path);
+    bool isOverlayAttached() const { return replay_overlay != nullptr; }
+    uint32_t getOverlaySequence() const;    // Last replayed transaction, 0 without an overlay
+    
+    // Identity of the filesystem/journal used to key sidecar files
+    uint64_t getImageFingerprint();
+    uint64_t getSuperblockFingerprint();    // Of the base image, never the overlay
     
     // Getters
     long getJournalOffset() const { return journal_location.offset; }
@@ -54,6 +110,12 @@ public:
     long getPartitionOffset() const { return partition_offset; }
     ImageType getImageType() const { return current_type; }
     const std::string& getImagePath() const { return image_path; }
+    uint32_t getFilesystemBlockSize() const { return fs_block_size; }
+    uint16_t getFilesystemInodeSize() const { return fs_inode_size; }
+    long getMetadataRegionSize() const { return metadata_region_size; }
+    long getJournalInodeBlockOffset() const { return journal_inode_block_offset; }
+    const std::vector<BlockExtent>& getJournalExtents() const { return journal_extents; }
+    const std::vector<uint64_t>& getJournalMapBlocks() const { return journal_map_blocks; }
 };
 
 #endif // IMAGE_HANDLER_H
\ No newline at end of file
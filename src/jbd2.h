@@ -0,0 +1,28 @@
+#ifndef JBD2_H
+#define JBD2_H
+
+#include <cstdint>
+#include <cstring>
+
+// On-disk conventions of the JBD/JBD2 journal: transaction ordering, the
+// block magic and escaped data blocks.
+
+// Transaction IDs wrap at 2^32, so compare them the way jbd2 does: a is newer than b
+inline bool tidGreater(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) > 0;
+}
+
+// Magic number that starts every journal metadata block (big-endian on disk)
+static const uint32_t JBD2_MAGIC_NUMBER = 0xC03B3998;
+
+// A data block that began with the journal magic is logged with JBD2_FLAG_ESCAPE
+// and its first four bytes zeroed; put the magic back
+inline void restoreEscapedMagic(char* block) {
+    const unsigned char magic[4] = {
+        static_cast<unsigned char>(JBD2_MAGIC_NUMBER >> 24), static_cast<unsigned char>(JBD2_MAGIC_NUMBER >> 16),
+        static_cast<unsigned char>(JBD2_MAGIC_NUMBER >> 8), static_cast<unsigned char>(JBD2_MAGIC_NUMBER)
+    };
+    memcpy(block, magic, sizeof(magic));
+}
+
+#endif // JBD2_H
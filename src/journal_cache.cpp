@@ -0,0 +1,188 @@
+#include "journal_cache.h"
+#include "image_handler.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+
+static const char JVCACHE_MAGIC[8] = {'J', 'V', 'C', 'A', 'C', 'H', 'E', 0};
+
+JournalCache::JournalCache() : header() {
+}
+
+bool JournalCache::create(ImageHandler& image_handler, const std::string& path) {
+    std::vector<JournalCacheRange> wanted;
+    auto add_range = [&](int64_t offset, uint64_t length) {
+        if (length > 0) {
+            wanted.push_back({offset, length, 0});
+        }
+    };
+
+    uint64_t block_size = image_handler.getFilesystemBlockSize();
+    const std::vector<BlockExtent>& extents = image_handler.getJournalExtents();
+
+    if (!extents.empty()) {
+        // Everything locateJournal() reads, then the journal itself
+        add_range(0, image_handler.getMetadataRegionSize());
+        add_range(image_handler.getJournalInodeBlockOffset(), block_size);
+        for (uint64_t block : image_handler.getJournalMapBlocks()) {
+            add_range(block * block_size, block_size);
+        }
+        for (const auto& extent : extents) {
+            add_range(extent.physical * block_size, static_cast<uint64_t>(extent.length) * block_size);
+        }
+    } else {
+        // Journal given by offset (or found by searching): treat it as contiguous
+        int64_t journal_size = image_handler.getJournalSize();
+        if (journal_size <= 0) {
+            // Size from the journal superblock: s_blocksize * s_maxlen, big-endian
+            unsigned char jsb[24];
+            if (!image_handler.readImageBytes(image_handler.getJournalOffset(), reinterpret_cast<char*>(jsb), sizeof(jsb))) {
+                std::cerr << "Error: Cannot read journal superblock for cache" << std::endl;
+                return false;
+            }
+            uint64_t jbs = (uint64_t(jsb[12]) << 24) | (jsb[13] << 16) | (jsb[14] << 8) | jsb[15];
+            uint64_t maxlen = (uint64_t(jsb[16]) << 24) | (jsb[17] << 16) | (jsb[18] << 8) | jsb[19];
+            journal_size = static_cast<int64_t>(jbs * maxlen);
+        }
+        if (block_size > 0) {
+            add_range(0, image_handler.getMetadataRegionSize());
+        } else {
+            add_range(1024, 1024); // Superblock only
+        }
+        add_range(image_handler.getJournalOffset(), journal_size);
+    }
+
+    // Sort and merge overlapping or adjacent ranges
+    std::sort(wanted.begin(), wanted.end(),
+              [](const JournalCacheRange& a, const JournalCacheRange& b) { return a.image_offset < b.image_offset; });
+    std::vector<JournalCacheRange> merged;
+    for (const auto& range : wanted) {
+        if (!merged.empty() &&
+            range.image_offset <= merged.back().image_offset + static_cast<int64_t>(merged.back().length)) {
+            int64_t end = std::max<int64_t>(merged.back().image_offset + merged.back().length,
+                                            range.image_offset + range.length);
+            merged.back().length = end - merged.back().image_offset;
+        } else {
+            merged.push_back(range);
+        }
+    }
+
+    JournalCacheFileHeader file_header = JournalCacheFileHeader();
+    memcpy(file_header.magic, JVCACHE_MAGIC, sizeof(file_header.magic));
+    file_header.version = CACHE_VERSION;
+    file_header.range_count = static_cast<uint32_t>(merged.size());
+    file_header.superblock_fingerprint = image_handler.getSuperblockFingerprint();
+    file_header.partition_offset = image_handler.getPartitionOffset();
+    file_header.journal_offset = image_handler.getJournalOffset();
+    file_header.journal_size = image_handler.getJournalSize();
+
+    uint64_t file_offset = sizeof(JournalCacheFileHeader) + merged.size() * sizeof(JournalCacheRange);
+    for (auto& range : merged) {
+        range.file_offset = file_offset;
+        file_offset += range.length;
+        file_header.data_bytes += range.length;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot create journal cache file: " << path << std::endl;
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+    out.write(reinterpret_cast<const char*>(merged.data()), merged.size() * sizeof(JournalCacheRange));
+
+    // Copy the base image, never replayed blocks of an attached overlay, in
+    // chunks no larger than ImageHandler::readBytes accepts
+    const size_t chunk_size = 1024 * 1024;
+    std::vector<char> chunk(chunk_size);
+    for (const auto& range : merged) {
+        uint64_t copied = 0;
+        while (copied < range.length) {
+            size_t size = static_cast<size_t>(std::min<uint64_t>(chunk_size, range.length - copied));
+            if (!image_handler.readImageBytes(static_cast<long>(range.image_offset + copied), chunk.data(), size)) {
+                std::cerr << "Error: Failed to read image at offset " << (range.image_offset + copied)
+                          << " while building journal cache" << std::endl;
+                out.close();
+                std::remove(path.c_str());
+                return false;
+            }
+            out.write(chunk.data(), size);
+            copied += size;
+        }
+    }
+
+    // Close first so a failed final flush counts too; never leave a truncated file behind
+    out.close();
+    if (out.fail()) {
+        std::cerr << "Error: Failed writing journal cache file: " << path << std::endl;
+        std::remove(path.c_str());
+        return false;
+    }
+
+    std::cout << "Wrote journal cache with " << merged.size() << " regions ("
+              << file_header.data_bytes << " bytes) to " << path << std::endl;
+    return true;
+}
+
+bool JournalCache::open(const std::string& path, uint64_t superblock_fingerprint, int64_t partition_offset) {
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false; // No cache yet
+    }
+
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || memcmp(header.magic, JVCACHE_MAGIC, sizeof(JVCACHE_MAGIC)) != 0 ||
+        header.version != CACHE_VERSION) {
+        std::cerr << "Warning: " << path << " is not a compatible journal cache, rebuilding" << std::endl;
+        file.close();
+        return false;
+    }
+
+    if (header.superblock_fingerprint != superblock_fingerprint || header.partition_offset != partition_offset) {
+        std::cerr << "Warning: Journal cache " << path << " was built for a different image, rebuilding" << std::endl;
+        file.close();
+        return false;
+    }
+
+    ranges.resize(header.range_count);
+    file.read(reinterpret_cast<char*>(ranges.data()), ranges.size() * sizeof(JournalCacheRange));
+
+    // The ranges must be sorted and their data must lie inside the file
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    bool valid = file.good();
+    for (size_t i = 0; valid && i < ranges.size(); ++i) {
+        valid = ranges[i].file_offset <= file_size && ranges[i].length <= file_size - ranges[i].file_offset &&
+                (i == 0 || ranges[i].image_offset >= ranges[i - 1].image_offset + static_cast<int64_t>(ranges[i - 1].length));
+    }
+    if (!valid) {
+        std::cerr << "Warning: Journal cache " << path << " is corrupt, rebuilding" << std::endl;
+        ranges.clear();
+        file.close();
+        return false;
+    }
+
+    std::cout << "Using journal cache " << path << " (" << header.data_bytes << " bytes in "
+              << ranges.size() << " regions)" << std::endl;
+    return true;
+}
+
+bool JournalCache::read(long offset, char* buffer, size_t size) {
+    // Last range starting at or before offset
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), static_cast<int64_t>(offset),
+                               [](int64_t value, const JournalCacheRange& r) { return value < r.image_offset; });
+    if (it == ranges.begin()) {
+        return false;
+    }
+    --it;
+    if (static_cast<uint64_t>(offset - it->image_offset) + size > it->length) {
+        return false;
+    }
+
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(it->file_offset + (offset - it->image_offset)));
+    file.read(buffer, size);
+    return file.good() && file.gcount() == static_cast<std::streamsize>(size);
+}
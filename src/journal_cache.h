@@ -0,0 +1,61 @@
+#ifndef JOURNAL_CACHE_H
+#define JOURNAL_CACHE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+class ImageHandler;
+
+// On-disk layout of a journal cache file: the header, then range_count
+// JournalCacheRange records, then the cached bytes of every range back to back.
+struct JournalCacheFileHeader {
+    char magic[8];                  // "JVCACHE\0"
+    uint32_t version;
+    uint32_t range_count;
+    uint64_t superblock_fingerprint; // ImageHandler::getSuperblockFingerprint()
+    int64_t partition_offset;       // Partition offset in bytes
+    int64_t journal_offset;         // Journal offset relative to the partition
+    int64_t journal_size;
+    uint64_t data_bytes;            // Total size of the cached ranges
+};
+
+// A cached byte range of the partition
+struct JournalCacheRange {
+    int64_t image_offset;           // Offset relative to the partition
+    uint64_t length;
+    uint64_t file_offset;           // Offset of the cached bytes in the cache file
+};
+
+// Local copy of the regions needed to analyse the journal: the boot block,
+// superblock and group descriptor table, the inode table block holding inode 8,
+// its extent/indirect blocks and every journal extent. Attached to an
+// ImageHandler, it serves reads inside those regions so that re-runs against
+// slow (E01, network) evidence stay local.
+class JournalCache {
+private:
+    static const uint32_t CACHE_VERSION = 1;
+
+    JournalCacheFileHeader header;
+    std::vector<JournalCacheRange> ranges;   // Sorted by image_offset, non-overlapping
+    std::ifstream file;
+
+public:
+    JournalCache();
+
+    // Extract the regions from a located journal into a new cache file
+    static bool create(ImageHandler& image_handler, const std::string& path);
+
+    // Open an existing cache; fails if it was built from a different image
+    bool open(const std::string& path, uint64_t superblock_fingerprint, int64_t partition_offset);
+
+    // Read a partition-relative range; false if it is not fully cached
+    bool read(long offset, char* buffer, size_t size);
+
+    size_t getRangeCount() const { return ranges.size(); }
+    uint64_t getCachedBytes() const { return header.data_bytes; }
+};
+
+#endif // JOURNAL_CACHE_H
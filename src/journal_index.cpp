@@ -0,0 +1,174 @@
+#include "journal_index.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char JVIDX_MAGIC[8] = {'J', 'V', 'I', 'D', 'X', 0, 0, 0};
+
+JournalIndex::JournalIndex() : header(), transactions_view(nullptr), block_view(nullptr),
+                               transaction_count(0), block_count(0),
+                               mapped_data(nullptr), mapped_size(0), loaded(false) {
+}
+
+JournalIndex::~JournalIndex() {
+    unmap();
+}
+
+void JournalIndex::unmap() {
+    if (mapped_data) {
+        munmap(mapped_data, mapped_size);
+        mapped_data = nullptr;
+        mapped_size = 0;
+    }
+    loaded = false;
+}
+
+void JournalIndex::reset(const JournalIndexKey& key) {
+    unmap();
+
+    header = JournalIndexFileHeader();
+    memcpy(header.magic, JVIDX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.image_fingerprint = key.image_fingerprint;
+    header.partition_offset = key.partition_offset;
+    header.journal_offset = key.journal_offset;
+
+    transaction_entries.clear();
+    block_entries.clear();
+    finalize();
+}
+
+void JournalIndex::addBlockVersion(uint64_t fs_block, uint32_t sequence, uint32_t journal_block) {
+    IndexBlockVersionEntry entry;
+    entry.fs_block = fs_block;
+    entry.sequence = sequence;
+    entry.journal_block = journal_block;
+    block_entries.push_back(entry);
+}
+
+// Sort the lookup table (stable, so versions of one block stay in log order)
+// and point the lookup views at the build-time vectors
+void JournalIndex::finalize() {
+    std::stable_sort(block_entries.begin(), block_entries.end(),
+                     [](const IndexBlockVersionEntry& a, const IndexBlockVersionEntry& b) {
+                         return a.fs_block < b.fs_block;
+                     });
+
+    transactions_view = transaction_entries.data();
+    transaction_count = transaction_entries.size();
+    block_view = block_entries.data();
+    block_count = block_entries.size();
+}
+
+bool JournalIndex::write(const std::string& path) {
+    finalize();
+
+    // Sections follow the header back to back; all record sizes are multiples of 8
+    header.transaction_count = transaction_count;
+    header.transactions_offset = sizeof(JournalIndexFileHeader);
+    header.block_version_count = block_count;
+    header.block_versions_offset = header.transactions_offset + transaction_count * sizeof(IndexTransactionEntry);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot create index file: " << path << std::endl;
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(transaction_entries.data()),
+               transaction_count * sizeof(IndexTransactionEntry));
+    file.write(reinterpret_cast<const char*>(block_entries.data()),
+               block_count * sizeof(IndexBlockVersionEntry));
+
+    if (!file.good()) {
+        std::cerr << "Error: Failed writing index file: " << path << std::endl;
+        return false;
+    }
+
+    std::cout << "Wrote journal index with " << transaction_count << " transactions and "
+              << block_count << " block versions to " << path << std::endl;
+    return true;
+}
+
+bool JournalIndex::load(const std::string& path, const JournalIndexKey& expected) {
+    unmap();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false; // No index yet
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(JournalIndexFileHeader)) {
+        close(fd);
+        std::cerr << "Warning: Index file " << path << " is truncated, rebuilding" << std::endl;
+        return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Warning: Cannot map index file " << path << ", rebuilding" << std::endl;
+        return false;
+    }
+
+    mapped_data = data;
+    mapped_size = st.st_size;
+
+    const JournalIndexFileHeader* file_header = static_cast<const JournalIndexFileHeader*>(data);
+    if (memcmp(file_header->magic, JVIDX_MAGIC, sizeof(JVIDX_MAGIC)) != 0 ||
+        file_header->version != INDEX_VERSION) {
+        std::cerr << "Warning: " << path << " is not a compatible journal index, rebuilding" << std::endl;
+        unmap();
+        return false;
+    }
+
+    if (file_header->image_fingerprint != expected.image_fingerprint ||
+        file_header->partition_offset != expected.partition_offset ||
+        file_header->journal_offset != expected.journal_offset) {
+        std::cerr << "Warning: Index " << path << " was built for a different image or journal, rebuilding" << std::endl;
+        unmap();
+        return false;
+    }
+
+    // Every section must lie inside the file
+    auto section_fits = [&](uint64_t offset, uint64_t count, size_t record_size) {
+        return offset <= mapped_size && count <= (mapped_size - offset) / record_size;
+    };
+    if (!section_fits(file_header->transactions_offset, file_header->transaction_count, sizeof(IndexTransactionEntry)) ||
+        !section_fits(file_header->block_versions_offset, file_header->block_version_count, sizeof(IndexBlockVersionEntry))) {
+        std::cerr << "Warning: Index file " << path << " is corrupt, rebuilding" << std::endl;
+        unmap();
+        return false;
+    }
+
+    header = *file_header;
+    const char* base = static_cast<const char*>(data);
+    transactions_view = reinterpret_cast<const IndexTransactionEntry*>(base + header.transactions_offset);
+    transaction_count = header.transaction_count;
+    block_view = reinterpret_cast<const IndexBlockVersionEntry*>(base + header.block_versions_offset);
+    block_count = header.block_version_count;
+
+    transaction_entries.clear();
+    block_entries.clear();
+    loaded = true;
+    return true;
+}
+
+std::pair<const IndexBlockVersionEntry*, const IndexBlockVersionEntry*>
+JournalIndex::findBlockVersions(uint64_t fs_block) const {
+    const IndexBlockVersionEntry* first = block_view;
+    const IndexBlockVersionEntry* last = block_view + block_count;
+
+    auto lower = std::lower_bound(first, last, fs_block,
+                                  [](const IndexBlockVersionEntry& e, uint64_t value) { return e.fs_block < value; });
+    auto upper = std::upper_bound(lower, last, fs_block,
+                                  [](uint64_t value, const IndexBlockVersionEntry& e) { return value < e.fs_block; });
+    return std::make_pair(lower, upper);
+}
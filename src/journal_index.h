@@ -0,0 +1,108 @@
+#ifndef JOURNAL_INDEX_H
+#define JOURNAL_INDEX_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Identity of the journal an index was built from
+struct JournalIndexKey {
+    uint64_t image_fingerprint;   // ImageHandler::getImageFingerprint()
+    int64_t partition_offset;     // Partition offset in bytes
+    int64_t journal_offset;       // Journal offset relative to the partition
+};
+
+// On-disk layout of a .jvidx sidecar file. Every section is an array of
+// fixed-size little-endian records so the file can be used directly via mmap.
+struct JournalIndexFileHeader {
+    char magic[8];                  // "JVIDX\0\0\0"
+    uint32_t version;
+    uint32_t block_size;            // Journal block size
+    uint64_t image_fingerprint;
+    int64_t partition_offset;
+    int64_t journal_offset;
+    uint32_t walk_mode;             // JournalWalkMode used to build the index
+    uint32_t reserved;
+    uint64_t transaction_count;
+    uint64_t transactions_offset;
+    uint64_t block_version_count;
+    uint64_t block_versions_offset;
+};
+
+// One transaction, in walk order
+struct IndexTransactionEntry {
+    uint32_t sequence;
+    uint32_t first_block;           // Log block of the first descriptor/revoke block
+    uint32_t commit_block;          // Log block of the commit block
+    uint32_t data_blocks;           // Number of journaled fs blocks
+    uint32_t flags;                 // INDEX_FLAG_*
+    uint32_t reserved;
+};
+
+// fs block -> journaled copy, sorted by fs block then log order
+struct IndexBlockVersionEntry {
+    uint64_t fs_block;
+    uint32_t sequence;
+    uint32_t journal_block;         // Log block holding the copy
+};
+
+// Persistent sidecar index over journal transactions and fs blocks. Inode
+// queries go through the fs block of their inode table slot.
+class JournalIndex {
+private:
+    static const uint32_t INDEX_VERSION = 2;
+
+    JournalIndexFileHeader header;
+
+    // Build-time storage
+    std::vector<IndexTransactionEntry> transaction_entries;
+    std::vector<IndexBlockVersionEntry> block_entries;
+
+    // Views used for lookups (either the vectors above or the mapped file)
+    const IndexTransactionEntry* transactions_view;
+    const IndexBlockVersionEntry* block_view;
+    size_t transaction_count;
+    size_t block_count;
+
+    void* mapped_data;
+    size_t mapped_size;
+    bool loaded;
+
+    void unmap();
+
+public:
+    static const uint32_t INDEX_FLAG_STALE = 0x1;       // Recovered outside the live log
+    static const uint32_t INDEX_FLAG_INCOMPLETE = 0x2;  // No commit block was found
+
+    JournalIndex();
+    ~JournalIndex();
+
+    JournalIndex(const JournalIndex&) = delete;
+    JournalIndex& operator=(const JournalIndex&) = delete;
+
+    // Building
+    void reset(const JournalIndexKey& key);
+    void setBlockSize(uint32_t block_size) { header.block_size = block_size; }
+    void setWalkMode(uint32_t walk_mode) { header.walk_mode = walk_mode; }
+    void addTransaction(const IndexTransactionEntry& entry) { transaction_entries.push_back(entry); }
+    void addBlockVersion(uint64_t fs_block, uint32_t sequence, uint32_t journal_block);
+    void finalize();                                // Sort build-time tables for lookups
+    bool write(const std::string& path);
+
+    // Loading
+    bool load(const std::string& path, const JournalIndexKey& expected);
+    bool isLoaded() const { return loaded; }
+
+    // Lookups
+    uint32_t getBlockSize() const { return header.block_size; }
+    uint32_t getWalkMode() const { return header.walk_mode; }
+    size_t getTransactionCount() const { return transaction_count; }
+    const IndexTransactionEntry* getTransactions() const { return transactions_view; }
+    size_t getBlockVersionCount() const { return block_count; }
+
+    // Versions of one fs block as a [first, last) range in log order
+    std::pair<const IndexBlockVersionEntry*, const IndexBlockVersionEntry*> findBlockVersions(uint64_t fs_block) const;
+};
+
+#endif // JOURNAL_INDEX_H
@@ -5,7 +5,16 @@
 #include <string>
 #include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include "image_handler.h"
+#include "journal_index.h"
+#include "ext_filesystem.h"
+#include "block_owner_map.h"
+#include "replay_overlay.h"
+#include "block_version_map.h"
+#include "path_trie.h"
+#include "flat_hash.h"
+#include "jbd2.h"
 
 // JBD2 block types
 enum class JournalBlockType {
@@ -63,13 +72,18 @@ enum class BlockContentType {
     INODE_TABLE,
     DIRECTORY,
     FILE_DATA,
-    METADATA
+    METADATA,
+    SUPERBLOCK,         // Known from the group layout only
+    GROUP_DESCRIPTORS,  // Includes reserved GDT blocks
+    BLOCK_BITMAP,
+    INODE_BITMAP,
+    EXTENT_TREE         // Extent index or leaf block (magic 0xF30A)
 };
 
 // EXT4 directory entry structure
 struct EXT4DirectoryEntry {
     uint32_t inode;         // Inode number
-    uint16_t rec_len;       // Record length
+    uint32_t rec_len;       // Record length (decoded, can be 65536 on 64K blocks)
     uint8_t name_len;       // Name length
     uint8_t file_type;      // File type
     std::string name;       // Filename (variable length)
@@ -98,6 +112,13 @@ enum class JournalMode {
     WRITEBACK_MODE   // Only critical metadata journaled
 };
 
+// Journal walk strategies
+enum class JournalWalkMode {
+    LINEAR_SCAN,      // Visit every journal block in physical order
+    LOG_ORDER,        // Follow live transactions from s_start across the wrap
+    LOG_ORDER_STALE   // Log order walk plus a sweep for stale transactions
+};
+
 // Forensic analysis statistics
 struct ForensicAnalysis {
     // Journal characteristics
@@ -113,6 +134,7 @@ struct ForensicAnalysis {
     size_t descriptor_blocks;
     size_t commit_blocks;
     size_t revocation_blocks;
+    size_t revoked_copies;             // Data rows for copies a replay would skip because of revoke records
     size_t data_blocks_found;
     
     // Activity patterns
@@ -139,16 +161,22 @@ struct ForensicAnalysis {
     size_t log_file_blocks;            // Blocks containing log entries
     std::vector<std::string> sample_extracted_strings; // Sample strings for analysis
     
+    // Journal walk results
+    std::string walk_mode;              // Strategy used to traverse the journal
+    size_t live_transactions;           // Transactions reached from s_start
+    size_t stale_transactions;          // Transactions recovered outside the live log
+    
     ForensicAnalysis() : detected_mode(JournalMode::UNKNOWN), journal_type("Unknown"),
                         total_transactions(0), total_blocks_scanned(0), valid_journal_blocks(0),
                         sequence_range_start(0), sequence_range_end(0), descriptor_blocks(0),
-                        commit_blocks(0), revocation_blocks(0), data_blocks_found(0),
+                        commit_blocks(0), revocation_blocks(0), revoked_copies(0), data_blocks_found(0),
                         avg_descriptors_per_transaction(0), max_descriptors_per_transaction(0),
                         has_timestamps(false), transaction_gaps(0), rapid_transactions(0),
                         potential_data_recovery(false), metadata_only_mode(false),
                         high_activity_detected(false), filesystem_blocks_modified(0),
                         data_blocks_with_strings(0), total_extracted_strings(0),
-                        text_file_blocks(0), config_file_blocks(0), log_file_blocks(0) {}
+                        text_file_blocks(0), config_file_blocks(0), log_file_blocks(0),
+                        walk_mode("linear_scan"), live_transactions(0), stale_transactions(0) {}
 };
 
 // Change type for tracking modifications
@@ -162,7 +190,20 @@ enum class ChangeType {
     SIZE_CHANGE,
     LINK_COUNT_CHANGE,
     PERMISSION_CHANGE,
-    OWNERSHIP_CHANGE
+    OWNERSHIP_CHANGE,
+    TIMESTAMP_CHANGE,
+    FIRST_VERSION,      // First journaled copy seen of an inode, directory or bitmap block
+    NO_CHANGE,
+    ALLOCATED,          // Bitmap bits set since the previous copy
+    FREED               // Bitmap bits cleared since the previous copy
+};
+
+// One added, removed or renamed entry between two journaled copies of a directory block
+struct DirectoryEntryChange {
+    EXT4DirectoryEntry entry;       // Entry as it is now (as it was, for removals)
+    FileOperationType operation;
+    ChangeType change_type;
+    std::string detail;             // added, removed, renamed:old->new, inode:old->new
 };
 
 // Journal transaction record with Phase 1 enhancements
@@ -189,7 +230,17 @@ struct JournalTransaction {
     std::string change_type;       // Type of change (new_entry, removed_entry, etc.)
     
     // Phase 3 additions
-    std::string full_path;         // Complete file path from root
+    uint32_t path_id = PathTrie::NO_PATH; // Complete file path from root, as a JournalParser::getPathTrie() id
+    uint32_t path_inode = 0;       // Inode whose path is still to be resolved (deferred paths)
+    
+    // Log walk additions
+    std::string log_state;         // live/stale when walking in log order, empty for linear scans
+    
+    // Timeline additions
+    std::string change_detail;     // Fields changed since the previous journaled copy (field:old->new;...)
+    
+    // Revocation additions
+    bool revoked = false;          // Data copy revoked by a revoke record at or after its transaction
 };
 
 // Descriptor block entry
@@ -198,94 +249,131 @@ struct DescriptorEntry {
     uint32_t flags;
 };
 
+// One journaled copy of a queried fs block
+struct BlockVersion {
+    uint32_t sequence;              // Transaction that journaled the copy
+    uint32_t journal_block;         // Log block holding the copy
+    uint64_t fs_block;
+    std::string log_state;          // live/stale, empty for linear scans
+    std::vector<char> data;         // Block contents with any escaped magic restored
+};
+
+// One (parent, name) of an inode, in effect from first_seq until the next link
+struct DirectoryLink {
+    uint32_t parent_inode;
+    uint32_t first_seq;             // Transaction that first journaled this link
+    std::string name;
+};
+
 // Directory tree node for Phase 3
 struct DirectoryNode {
     uint32_t inode_number;
-    uint32_t parent_inode;
-    std::string name;
-    std::string full_path;
     bool is_directory;
     std::vector<uint32_t> children;
+    std::vector<DirectoryLink> links;   // Ordered by first_seq; the last one is the current name
     
-    DirectoryNode() : inode_number(0), parent_inode(0), name(""), full_path(""), is_directory(false) {}
+    DirectoryNode() : inode_number(0), is_directory(false) {}
 };
 
-// Phase 3: Directory tree builder and path resolver
+// Phase 3: Directory tree builder and path resolver. The tree is versioned by
+// transaction sequence, so a path resolves to the names in effect at that
+// transaction rather than whatever was learned last.
 class DirectoryTreeBuilder {
 private:
-    std::unordered_map<uint32_t, DirectoryNode> nodes;           // inode -> node mapping
-    std::unordered_map<uint32_t, std::string> path_cache;        // inode -> cached full path
-    std::unordered_map<std::string, uint32_t> name_to_inode;     // name -> inode mapping
+    FlatHashMap<uint32_t, DirectoryNode> nodes;                  // inode -> node mapping
+    FlatHashSet<uint64_t> child_links;                           // (parent << 32) | child already in a children list
     uint32_t root_inode;
     
     static constexpr uint32_t EXT4_ROOT_INODE = 2;
     static constexpr uint32_t EXT4_LOST_FOUND_INODE = 11;
     static constexpr size_t MAX_PATH_DEPTH = 256;
     
+    const DirectoryLink* findLink(const DirectoryNode& node, uint32_t sequence) const;
+    
+    // How a walk towards the root ended
+    enum class PathStop {
+        ROOT,
+        LOST_FOUND,
+        UNKNOWN,        // Parent never named in the journal
+        CYCLE
+    };
+    size_t collectLinks(uint32_t inode, uint32_t sequence, const DirectoryLink** stack,
+                        PathStop& stop, uint32_t& stop_inode) const;
+    
 public:
     DirectoryTreeBuilder();
     ~DirectoryTreeBuilder();
     
     // Core functionality
-    void addDirectoryEntry(uint32_t dir_inode, const EXT4DirectoryEntry& entry);
+    void addDirectoryEntry(uint32_t dir_inode, const EXT4DirectoryEntry& entry, uint32_t sequence);
     void addInodeInfo(uint32_t inode, const EXT4Inode& inode_data);
-    std::string buildFullPath(uint32_t inode);
-    void clearCache();
+    std::string buildFullPath(uint32_t inode) const;                      // Newest names
+    std::string buildFullPath(uint32_t inode, uint32_t sequence) const;   // Names in effect at sequence
+    uint32_t buildPathId(uint32_t inode, uint32_t sequence, PathTrie& paths) const;
     
     // Path resolution
-    std::string resolvePath(uint32_t inode);
-    std::string getParentPath(uint32_t inode);
+    std::string resolvePath(uint32_t inode) const;
+    std::string getParentPath(uint32_t inode) const;
     bool isValidPath(const std::string& path);
     
     // Tree management
-    void updateNode(uint32_t inode, uint32_t parent_inode, const std::string& name, bool is_dir);
+    void updateNode(uint32_t inode, uint32_t parent_inode, const std::string& name, bool is_dir, uint32_t sequence);
+    void linkParent(uint32_t dir_inode, uint32_t parent_inode, uint32_t sequence);
     bool hasNode(uint32_t inode) const;
     const DirectoryNode* getNode(uint32_t inode) const;
     
     // Statistics and debugging
     size_t getNodeCount() const { return nodes.size(); }
-    size_t getCacheSize() const { return path_cache.size(); }
     void printTree(uint32_t root_inode = EXT4_ROOT_INODE, int depth = 0) const;
 };
 
+class DirectorySeed;
+
 class JournalParser {
 private:
-    static const uint32_t JBD2_MAGIC = 0x9839B3C0; // Little-endian of 0xC03B3998
-    static const uint32_t JBD_MAGIC = 0x98393BC0;  // Little-endian of 0xC03B3998 (JBD/EXT3)
     static const size_t JOURNAL_HEADER_SIZE = 12;
-    static const size_t BLOCK_SIZE = 4096; // Standard EXT block size
+    static const size_t MIN_BLOCK_SIZE = 1024;
+    static const size_t MAX_BLOCK_SIZE = 65536;
     
     // Helper methods
     bool parseJournalHeader(const char* data, JournalHeader& header);
     std::vector<DescriptorEntry> parseDescriptorBlock(const char* data, size_t size);
+    size_t journalTagBytes() const;
+    bool journalHasChecksumTail() const;
     bool parseCommitBlock(const char* data, size_t size, uint32_t& sequence);
     std::string inferOperationType(const char* data, size_t size);
-    std::string calculateChecksum(const char* data, size_t size);
     std::string formatTimestamp(uint64_t unix_timestamp);
     std::string blockTypeToString(JournalBlockType type);
     
     // Phase 1: Inode and block analysis
-    bool parseInodeBlock(const char* data, size_t size, std::vector<EXT4Inode>& inodes, std::vector<uint32_t>& inode_numbers);
-    BlockContentType identifyBlockType(const char* data, size_t size);
+    bool parseInodeBlock(const char* data, size_t size, std::vector<EXT4Inode>& inodes, std::vector<uint32_t>& inode_numbers,
+                         uint32_t first_inode = 0);
+    BlockContentType identifyBlockType(const char* data, size_t size, bool allow_inode_table = true);
+    BlockContentType classifyDataBlock(uint64_t fs_block, const char* data, size_t size, BlockLocation& location);
     std::string getFileTypeString(uint16_t mode);
     uint64_t getFullFileSize(const EXT4Inode& inode);
     uint32_t getFullUID(const EXT4Inode& inode);
     uint32_t getFullGID(const EXT4Inode& inode);
     
     // Phase 2: Directory operations detection
-    bool parseDirectoryBlock(const char* data, size_t size, std::vector<EXT4DirectoryEntry>& entries);
-    FileOperationType inferFileOperation(const std::vector<EXT4DirectoryEntry>& entries, 
-                                       const std::vector<EXT4Inode>& inodes,
-                                       uint32_t transaction_seq);
+    bool parseDirectoryBlock(const char* data, size_t size, std::vector<EXT4DirectoryEntry>& entries,
+                             std::vector<EXT4DirectoryEntry>* deleted = nullptr);
+    void scanDirectorySlack(const char* data, size_t start, size_t end, std::vector<EXT4DirectoryEntry>& deleted);
     std::string getOperationTypeString(FileOperationType op_type);
     std::string getChangeTypeString(ChangeType change_type);
-    ChangeType analyzeDirectoryChanges(const std::vector<EXT4DirectoryEntry>& entries);
+    void diffDirectoryEntries(const std::vector<EXT4DirectoryEntry>& before,
+                              const std::vector<EXT4DirectoryEntry>& after,
+                              std::vector<DirectoryEntryChange>& changes) const;
     
     // Phase 3: Path resolution and directory tree management
     DirectoryTreeBuilder directory_tree;
-    std::string buildFullPath(uint32_t inode);
+    PathTrie paths;                     // Every full_path handed out, shared by prefix
+    uint32_t resolvePathId(uint32_t inode, uint32_t sequence);
+    void assignPath(JournalTransaction& trans, uint32_t inode);
+    size_t resolveDeferredPaths(std::vector<JournalTransaction>& transactions, bool verbose);
+    uint32_t syntheticPath(const std::string& name);
     std::string resolveInodePath(uint32_t inode);
-    void updateDirectoryTree(const std::vector<EXT4DirectoryEntry>& entries, uint32_t parent_inode);
+    void updateDirectoryTree(const std::vector<EXT4DirectoryEntry>& entries, uint32_t parent_inode, uint32_t sequence);
     void updateDirectoryTreeFromInodes(const std::vector<EXT4Inode>& inodes, const std::vector<uint32_t>& inode_numbers);
     std::string handleSpecialPaths(uint32_t inode, const std::string& name);
     bool isRootDirectory(uint32_t inode);
@@ -298,6 +386,7 @@ private:
     void analyzeTransactionPatterns(const std::vector<JournalTransaction>& transactions);
     void generateForensicSummary() const;
     std::string getJournalModeString(JournalMode mode) const;
+    std::string getWalkModeString(JournalWalkMode mode) const;
     std::string generateRelativeTimestamp(uint32_t sequence_num, uint32_t base_sequence) const;
     
     // String analysis for data blocks
@@ -322,13 +411,124 @@ private:
     
     // Journal superblock parsing
     struct JournalSuperblock {
-        uint32_t block_size;
-        uint32_t max_len;
-        uint32_t first_transaction;
-        uint32_t sequence;
+        uint32_t block_type;        // V1 or V2 superblock
+        uint32_t block_size;        // s_blocksize
+        uint32_t max_len;           // s_maxlen: total blocks in the journal
+        uint32_t first_block;       // s_first: first block of the log
+        uint32_t sequence;          // s_sequence: first commit ID expected in the log
+        uint32_t start;             // s_start: first live log block (0 = clean journal)
+        uint32_t feature_compat;
+        uint32_t feature_incompat;
+        uint32_t feature_ro_compat;
+    };
+    
+    bool parseJournalSuperblock(ImageHandler& image_handler, JournalSuperblock& sb);
+    
+    // Journal walking
+    struct LogWalkStats {
+        size_t blocks_read;
+        size_t valid_headers;
+        size_t live_transactions;
+        size_t stale_transactions;
+        
+        LogWalkStats() : blocks_read(0), valid_headers(0), live_transactions(0), stale_transactions(0) {}
     };
     
-    bool parseJournalSuperblock(ImageHandler& image_handler, long offset, JournalSuperblock& sb);
+    JournalWalkMode walk_mode;
+    JournalSuperblock journal_sb;
+    bool journal_sb_valid;
+    LogWalkStats walk_stats;
+    JournalIndex* journal_index;        // Optional sidecar index (not owned)
+    const ExtFilesystem* filesystem;    // Optional group layout of the filesystem (not owned)
+    const DirectorySeed* directory_seed; // Optional on-disk directory names (not owned)
+    uint16_t inode_size;                // On-disk inode size used to decode inode table blocks
+    
+    // Inode timeline: last journaled state of each inode table slot, keyed by
+    // fs block, slot and whether the copy came from the stale part of the log
+    std::unordered_map<uint64_t, EXT4Inode> inode_states;
+    std::string diffInodeVersions(const EXT4Inode& before, const EXT4Inode& after, ChangeType& change_type) const;
+    
+    // Directory diffing: entries of the last journaled copy of each directory block,
+    // keyed by fs block and whether the copy came from the stale part of the log
+    std::unordered_map<uint64_t, std::vector<EXT4DirectoryEntry>> directory_states;
+    
+    // Reverse block map from the block maps of journaled inodes (real inode numbers only)
+    BlockOwnerMap block_owners;
+    void recordInodeBlocks(uint32_t inode_number, const EXT4Inode& inode);
+    bool attributeDataBlock(JournalTransaction& trans);
+    
+    // Bitmap diffing: last journaled copy of each bitmap block as 64-bit words,
+    // keyed by fs block and whether the copy came from the stale part of the log
+    std::unordered_map<uint64_t, std::vector<uint64_t>> bitmap_states;
+    void diffBitmapBlock(const char* data, uint64_t fs_block, const BlockLocation& location, bool inode_bitmap,
+                         const std::string& log_state, JournalTransaction& data_trans,
+                         std::vector<JournalTransaction>& transactions);
+    
+    // Revoke records: the latest revoking sequence of each fs block, as jbd2 recovery keeps
+    // them. A journaled copy is revoked when its transaction is not after that sequence.
+    std::unordered_map<uint64_t, uint32_t> revoked_blocks;
+    bool suppress_revoked;
+    size_t parseRevokeBlock(const char* block_buffer, uint32_t sequence, std::string& block_list);
+    size_t applyRevocations(std::vector<JournalTransaction>& transactions);
+    
+    // Every committed copy of each fs block seen by the walk
+    BlockVersionMap block_versions;
+    
+    // Replay: the newest non-revoked live copy of each fs block, resolved after the walk
+    bool record_replay;
+    std::vector<ReplayBlock> replay_blocks;     // Sorted by fs block
+    uint32_t replay_sequence;                   // Last committed live transaction walked
+    void resolveReplayBlocks();
+    
+    // Paths resolved after the walk instead of per row (resolveDeferredPaths)
+    bool deferred_paths;
+    
+    // Deleted entry recovery from directory slack; each (fs block, inode, name) is reported once
+    bool recover_deleted;
+    std::unordered_set<std::string> recovered_entries;
+    size_t block_size;                  // Journal block size (s_blocksize), 1K to 64K
+    
+    bool isRecordingIndex() const { return journal_index && !journal_index->isLoaded(); }
+    
+    // Point queries: only data blocks for these fs blocks are read
+    std::unordered_set<uint64_t> query_blocks;
+    std::vector<BlockVersion> query_versions;
+    
+    bool isQueryMode() const { return !query_blocks.empty(); }
+    bool isQueriedBlock(uint64_t fs_block) const { return query_blocks.empty() || query_blocks.count(fs_block) != 0; }
+    void recordQueryVersion(const char* data, uint64_t fs_block, uint32_t sequence,
+                            uint32_t journal_block, const std::string& log_state);
+    
+    void scanJournalLinear(ImageHandler& image_handler, long journal_size,
+                           int start_seq, int end_seq, bool verbose,
+                           std::vector<JournalTransaction>& transactions);
+    void walkJournalLog(ImageHandler& image_handler, JournalWalkMode mode,
+                        int start_seq, int end_seq, bool verbose,
+                        std::vector<JournalTransaction>& transactions);
+    void walkJournalIndex(ImageHandler& image_handler, int start_seq, int end_seq, bool verbose,
+                          std::vector<JournalTransaction>& transactions);
+    bool walkTransaction(ImageHandler& image_handler, uint32_t start_block, uint32_t sequence,
+                         const std::string& log_state, bool emit, bool verbose,
+                         std::vector<JournalTransaction>& transactions, uint32_t& next_block);
+    bool seekLogSequence(ImageHandler& image_handler, uint32_t target, uint32_t& block, uint32_t& sequence);
+    bool probeLogHeader(ImageHandler& image_handler, uint32_t pos, uint32_t limit,
+                        uint32_t& found_pos, JournalHeader& header);
+    uint32_t logPositionToBlock(uint32_t pos) const;
+    uint32_t nextLogBlock(uint32_t block) const;
+    bool readJournalBlock(ImageHandler& image_handler, uint32_t block, char* buffer);
+    
+    // Transaction record construction
+    void appendDescriptorRecord(std::vector<JournalTransaction>& transactions, uint32_t sequence,
+                                size_t entry_count, const char* block_buffer, const std::string& log_state);
+    void appendCommitRecord(std::vector<JournalTransaction>& transactions, uint32_t sequence,
+                            const char* block_buffer, const std::string& log_state);
+    void appendRevocationRecord(std::vector<JournalTransaction>& transactions, uint32_t sequence,
+                                const char* block_buffer, const std::string& log_state);
+    void appendDataBlockRecords(char* data_block_buffer, bool data_read_success,
+                                const DescriptorEntry& desc, uint32_t sequence,
+                                uint32_t journal_block, size_t data_block_index, bool verbose,
+                                const std::string& log_state,
+                                std::vector<JournalTransaction>& transactions);
 
 public:
     JournalParser();
@@ -340,6 +540,36 @@ public:
                                                 int end_seq = -1,
                                                 bool verbose = false);
     
+    // Block checksum of the CSV checksum column (8 hex digits, "" for no data)
+    static std::string calculateChecksum(const char* data, size_t size);
+    
+    // Configuration
+    void setWalkMode(JournalWalkMode mode) { walk_mode = mode; }
+    void setJournalIndex(JournalIndex* index) { journal_index = index; }
+    void setRecoverDeleted(bool recover) { recover_deleted = recover; }
+    void setSuppressRevoked(bool suppress) { suppress_revoked = suppress; }
+    void setDeferredPaths(bool deferred) { deferred_paths = deferred; }
+    void setDirectorySeed(const DirectorySeed* seed) { directory_seed = seed; }
+    void setRecordReplay(bool record) { record_replay = record; }
+    void setFilesystem(const ExtFilesystem* fs) { filesystem = (fs && fs->isLoaded()) ? fs : nullptr; }
+    void setQueryBlocks(const std::vector<uint64_t>& blocks) { query_blocks.clear(); query_blocks.insert(blocks.begin(), blocks.end()); }
+    
+    // Versions of the queried blocks collected by the last parseJournal() call, in walk order
+    const std::vector<BlockVersion>& getQueryVersions() const { return query_versions; }
+    
+    // Blocks a jbd2 replay of the walked live transactions would write (setRecordReplay)
+    const std::vector<ReplayBlock>& getReplayBlocks() const { return replay_blocks; }
+    uint32_t getReplaySequence() const { return replay_sequence; }
+    
+    // Path ids in JournalTransaction::path_id refer to this trie
+    const PathTrie& getPathTrie() const { return paths; }
+    
+    // Content of an fs block as it was after transaction sequence: the newest copy
+    // journaled at or before it, or the image when it was not journaled by then
+    const BlockVersionMap& getBlockVersions() const { return block_versions; }
+    bool readBlockAsOf(ImageHandler& image_handler, uint64_t fs_block, uint32_t sequence,
+                       std::vector<char>& data, BlockCopy& source, bool& journaled);
+    
     // Utility methods
     bool validateJournalStructure(ImageHandler& image_handler);
     size_t getEstimatedTransactionCount(ImageHandler& image_handler);
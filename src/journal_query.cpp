@@ -0,0 +1,261 @@
+#include "journal_query.h"
+#include "jbd2.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+
+// Inode fields shown in an inode history
+struct InodeSnapshot {
+    uint16_t mode;
+    uint32_t uid;
+    uint32_t gid;
+    uint64_t size;
+    uint16_t links;
+    uint32_t atime;
+    uint32_t ctime;
+    uint32_t mtime;
+    uint32_t dtime;
+    uint32_t flags;
+    uint32_t generation;
+};
+
+static InodeSnapshot decodeInode(const char* data) {
+    InodeSnapshot inode;
+    uint16_t uid_lo, gid_lo, uid_hi, gid_hi;
+    uint32_t size_lo, size_hi;
+
+    memcpy(&inode.mode, data + 0, 2);
+    memcpy(&uid_lo, data + 2, 2);
+    memcpy(&size_lo, data + 4, 4);
+    memcpy(&inode.atime, data + 8, 4);
+    memcpy(&inode.ctime, data + 12, 4);
+    memcpy(&inode.mtime, data + 16, 4);
+    memcpy(&inode.dtime, data + 20, 4);
+    memcpy(&gid_lo, data + 24, 2);
+    memcpy(&inode.links, data + 26, 2);
+    memcpy(&inode.flags, data + 32, 4);
+    memcpy(&inode.generation, data + 100, 4);
+    memcpy(&size_hi, data + 108, 4);
+    memcpy(&uid_hi, data + 120, 2);
+    memcpy(&gid_hi, data + 122, 2);
+
+    inode.uid = uid_lo | (static_cast<uint32_t>(uid_hi) << 16);
+    inode.gid = gid_lo | (static_cast<uint32_t>(gid_hi) << 16);
+    inode.size = size_lo | (static_cast<uint64_t>(size_hi) << 32);
+    return inode;
+}
+
+static std::string fileTypeName(uint16_t mode) {
+    switch (mode & 0xF000) {
+        case 0x8000: return "regular_file";
+        case 0x4000: return "directory";
+        case 0xA000: return "symlink";
+        case 0x2000: return "char_device";
+        case 0x6000: return "block_device";
+        case 0x1000: return "fifo";
+        case 0xC000: return "socket";
+        default: return mode == 0 ? "unallocated" : "unknown";
+    }
+}
+
+static std::string formatTime(uint32_t seconds) {
+    if (seconds == 0) {
+        return "-";
+    }
+    std::time_t time = static_cast<std::time_t>(seconds);
+    std::tm* tm_info = std::gmtime(&time);
+    std::stringstream ss;
+    ss << std::put_time(tm_info, "%Y-%m-%dT%H:%M:%SZ");
+    return ss.str();
+}
+
+JournalQuery::JournalQuery() : target(Target::NONE), fs_block(0), inode(0), inode_offset(0),
+                               inode_size(0), block_size(0) {
+}
+
+bool JournalQuery::setInode(const ExtFilesystem& filesystem, uint32_t inode_number) {
+    if (!filesystem.locateInode(inode_number, fs_block, inode_offset)) {
+        std::cerr << "Error: Cannot locate inode " << inode_number << " in the filesystem" << std::endl;
+        return false;
+    }
+
+    target = Target::INODE;
+    inode = inode_number;
+    inode_size = filesystem.getInodeSize();
+    block_size = filesystem.getBlockSize();
+    return true;
+}
+
+bool JournalQuery::setPath(ImageHandler& image_handler, ExtFilesystem& filesystem, const std::string& query_path) {
+    uint32_t inode_number = 0;
+    if (!filesystem.lookupPath(image_handler, query_path, inode_number)) {
+        std::cerr << "Error: Path " << query_path << " not found on the filesystem "
+                  << "(deleted files can be queried with --query-inode)" << std::endl;
+        return false;
+    }
+
+    path = query_path;
+    return setInode(filesystem, inode_number);
+}
+
+void JournalQuery::setBlock(uint64_t block, uint32_t fs_block_size) {
+    target = Target::BLOCK;
+    fs_block = block;
+    block_size = fs_block_size;
+}
+
+std::vector<uint64_t> JournalQuery::getTargetBlocks() const {
+    if (target == Target::NONE) {
+        return {};
+    }
+    return {fs_block};
+}
+
+void JournalQuery::printInodeVersion(const char* inode_data, const char* previous) const {
+    InodeSnapshot current = decodeInode(inode_data);
+
+    std::cout << "mode=0" << std::oct << current.mode << std::dec
+              << " type=" << fileTypeName(current.mode)
+              << " size=" << current.size
+              << " links=" << current.links
+              << " uid=" << current.uid
+              << " gid=" << current.gid
+              << " atime=" << formatTime(current.atime)
+              << " ctime=" << formatTime(current.ctime)
+              << " mtime=" << formatTime(current.mtime)
+              << " dtime=" << formatTime(current.dtime)
+              << " flags=0x" << std::hex << current.flags << std::dec;
+
+    if (previous) {
+        InodeSnapshot before = decodeInode(previous);
+        std::vector<std::string> changed;
+        if (before.mode != current.mode) changed.push_back("mode");
+        if (before.size != current.size) changed.push_back("size");
+        if (before.links != current.links) changed.push_back("links");
+        if (before.uid != current.uid || before.gid != current.gid) changed.push_back("owner");
+        if (before.atime != current.atime) changed.push_back("atime");
+        if (before.ctime != current.ctime) changed.push_back("ctime");
+        if (before.mtime != current.mtime) changed.push_back("mtime");
+        if (before.dtime != current.dtime) changed.push_back("dtime");
+        if (before.flags != current.flags) changed.push_back("flags");
+        if (before.generation != current.generation) changed.push_back("generation");
+        if (changed.empty() && memcmp(previous, inode_data, inode_size) != 0) changed.push_back("other");
+
+        std::cout << " changed=";
+        if (changed.empty()) {
+            std::cout << "none";
+        }
+        for (size_t i = 0; i < changed.size(); ++i) {
+            std::cout << (i > 0 ? "," : "") << changed[i];
+        }
+    }
+    std::cout << std::endl;
+}
+
+void JournalQuery::printBlockVersion(const char* data, size_t size, const char* previous) const {
+    std::cout << "checksum=" << JournalParser::calculateChecksum(data, size);
+
+    if (previous) {
+        size_t differing = 0;
+        for (size_t i = 0; i < size; ++i) {
+            if (data[i] != previous[i]) {
+                differing++;
+            }
+        }
+        std::cout << " changed_bytes=" << differing;
+    }
+
+    // Short printable preview to recognise text content
+    std::string preview;
+    for (size_t i = 0; i < size && preview.size() < 60; ++i) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if (c >= 32 && c < 127) {
+            preview += static_cast<char>(c);
+        } else if (!preview.empty() && preview.back() != ' ') {
+            preview += ' ';
+        }
+    }
+    if (!preview.empty() && preview.find_first_not_of(' ') != std::string::npos) {
+        std::cout << " preview=\"" << preview << "\"";
+    }
+    std::cout << std::endl;
+}
+
+void JournalQuery::printHistory(ImageHandler& image_handler, const std::vector<BlockVersion>& versions) const {
+    if (target == Target::NONE) {
+        return;
+    }
+
+    // Oldest first; stale copies from earlier laps of the log sort before live ones
+    std::vector<const BlockVersion*> ordered;
+    for (const auto& version : versions) {
+        if (version.fs_block == fs_block) {
+            ordered.push_back(&version);
+        }
+    }
+    std::stable_sort(ordered.begin(), ordered.end(), [](const BlockVersion* a, const BlockVersion* b) {
+        return tidGreater(b->sequence, a->sequence);
+    });
+
+    std::cout << std::endl;
+    if (target == Target::INODE) {
+        std::cout << "History of inode " << inode;
+        if (!path.empty()) {
+            std::cout << " (" << path << ")";
+        }
+        std::cout << ": inode table block " << fs_block << ", offset " << inode_offset << std::endl;
+    } else {
+        std::cout << "History of fs block " << fs_block << std::endl;
+    }
+    std::cout << ordered.size() << " journaled version(s)" << std::endl;
+
+    const char* previous = nullptr;
+    for (const BlockVersion* version : ordered) {
+        std::cout << "  seq " << version->sequence;
+        if (!version->log_state.empty()) {
+            std::cout << " [" << version->log_state << "]";
+        }
+        std::cout << " journal_block " << version->journal_block << ": ";
+
+        if (target == Target::INODE) {
+            if (inode_offset + inode_size > version->data.size()) {
+                std::cout << "inode lies outside the journaled copy" << std::endl;
+                continue;
+            }
+            const char* inode_data = version->data.data() + inode_offset;
+            printInodeVersion(inode_data, previous);
+            previous = inode_data;
+        } else {
+            printBlockVersion(version->data.data(), version->data.size(), previous);
+            previous = version->data.data();
+        }
+    }
+
+    // Current state on disk, for comparison with the newest journaled copy
+    std::vector<char> on_disk(target == Target::INODE ? inode_size : block_size);
+    long offset = static_cast<long>(fs_block * block_size) + (target == Target::INODE ? inode_offset : 0);
+    std::cout << "  on disk: ";
+    if (on_disk.empty() || !image_handler.readBytes(offset, on_disk.data(), on_disk.size())) {
+        std::cout << "unreadable" << std::endl;
+    } else if (target == Target::INODE) {
+        printInodeVersion(on_disk.data(), previous);
+    } else {
+        printBlockVersion(on_disk.data(), on_disk.size(),
+                          (previous && !ordered.empty() && ordered.back()->data.size() == on_disk.size()) ? previous : nullptr);
+    }
+}
+
+std::vector<JournalTransaction> JournalQuery::filterRows(const std::vector<JournalTransaction>& transactions) const {
+    std::vector<JournalTransaction> rows;
+    for (const auto& trans : transactions) {
+        // Inode table blocks give one row per changed inode; keep only the queried one
+        if (trans.block_type == "data" && trans.fs_block_num == fs_block &&
+            (target != Target::INODE || trans.inode_number == inode)) {
+            rows.push_back(trans);
+        }
+    }
+    return rows;
+}
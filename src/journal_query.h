@@ -0,0 +1,50 @@
+#ifndef JOURNAL_QUERY_H
+#define JOURNAL_QUERY_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "image_handler.h"
+#include "ext_filesystem.h"
+#include "journal_parser.h"
+
+// Point query over the journal: the version history of one inode, path or fs block.
+// The query is resolved to the fs block(s) that hold the object, the parser reads
+// only the journal blocks tagged with those fs blocks, and the collected copies
+// are decoded and printed oldest first, followed by the current on-disk state.
+class JournalQuery {
+private:
+    enum class Target {
+        NONE,
+        INODE,
+        BLOCK
+    };
+
+    Target target;
+    uint64_t fs_block;          // Block queried, or the inode table block holding the inode
+    uint32_t inode;
+    uint32_t inode_offset;      // Byte offset of the inode within fs_block
+    uint16_t inode_size;
+    uint32_t block_size;
+    std::string path;
+
+    void printInodeVersion(const char* inode_data, const char* previous) const;
+    void printBlockVersion(const char* data, size_t size, const char* previous) const;
+
+public:
+    JournalQuery();
+
+    // Query setup
+    bool setInode(const ExtFilesystem& filesystem, uint32_t inode_number);
+    bool setPath(ImageHandler& image_handler, ExtFilesystem& filesystem, const std::string& query_path);
+    void setBlock(uint64_t block, uint32_t fs_block_size);
+
+    // fs blocks the parser has to read from the journal
+    std::vector<uint64_t> getTargetBlocks() const;
+
+    // Output
+    void printHistory(ImageHandler& image_handler, const std::vector<BlockVersion>& versions) const;
+    std::vector<JournalTransaction> filterRows(const std::vector<JournalTransaction>& transactions) const;
+};
+
+#endif // JOURNAL_QUERY_H
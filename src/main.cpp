@@ -1,13 +1,20 @@
 #include <iostream>
 #include <string>
+#include <fstream>
 #include <cstring>
 #include <getopt.h>
 #include "image_handler.h"
 #include "journal_parser.h"
 #include "csv_exporter.h"
+#include "ext_filesystem.h"
+#include "journal_query.h"
+#include "directory_seed.h"
 
 void print_usage(const char* program_name) {
-    std::cout << "Usage: " << program_name << " -i <image_file> -o <output.csv> [options]\n\n";
+    std::cout << "Usage: " << program_name << " -i <image_file> -o <output.csv> [options]\n";
+    std::cout << "       " << program_name << " -i <image_file> --query-inode|--query-block|--query-path <target> [-o <output.csv>]\n";
+    std::cout << "       " << program_name << " -i <image_file> --replay <overlay> [--replay-through <seq>] [-o <output.csv>]\n";
+    std::cout << "       " << program_name << " -i <image_file> --extract-block <n> --as-of <seq> --extract-out <file> [-o <output.csv>]\n\n";
     std::cout << "Required arguments:\n";
     std::cout << "  -i, --image <file>     Input image file path\n";
     std::cout << "  -o, --output <file>    Output CSV file path\n\n";
@@ -23,11 +30,36 @@ void print_usage(const char* program_name) {
     std::cout << "      --sector-size <size>  Sector size in bytes [default: 512]\n";
     std::cout << "      --start-seq        Start from specific sequence number\n";
     std::cout << "      --end-seq          End at specific sequence number\n";
+    std::cout << "      --walk <mode>      Journal walk mode (scan|log|log+stale) [default: scan]\n";
+    std::cout << "      --index <file>     Sidecar journal index (.jvidx), built on first run and reused after\n";
+    std::cout << "      --journal-cache <file>  Local copy of the journal and fs metadata, built on first run and read after\n";
+    std::cout << "      --recover-deleted  Recover deleted directory entries from rec_len slack\n";
+    std::cout << "      --suppress-revoked Drop journaled copies that a revoke record cancels\n";
+    std::cout << "      --deferred-paths   Resolve full paths after the whole journal has been read\n";
+    std::cout << "      --seed-tree        Seed path resolution with the directory tree on the filesystem\n";
+    std::cout << "      --seed-cache <file>  Directory tree file (.jvtree), built on first run and reused after (implies --seed-tree)\n";
     std::cout << "      --no-header        Omit CSV header row\n\n";
+    std::cout << "Point queries (print the version history of one object):\n";
+    std::cout << "      --query-inode <n>  History of inode n\n";
+    std::cout << "      --query-block <n>  History of filesystem block n\n";
+    std::cout << "      --query-path <p>   History of the inode at absolute path p on the filesystem\n\n";
+    std::cout << "Journal replay (the image itself is never written):\n";
+    std::cout << "      --replay <file>    Replay committed, non-revoked live transactions into an overlay file\n";
+    std::cout << "      --replay-through <n>  Stop the replay after transaction n\n";
+    std::cout << "      --overlay <file>   Read the image with a replay overlay applied\n\n";
+    std::cout << "Point-in-time extraction:\n";
+    std::cout << "      --extract-block <n>  Filesystem block to reconstruct\n";
+    std::cout << "      --as-of <seq>      Reconstruct the block as it was after transaction seq\n";
+    std::cout << "      --extract-out <file>  File the reconstructed block is written to\n\n";
     std::cout << "Examples:\n";
     std::cout << "  " << program_name << " -i evidence.E01 -o journal_analysis.csv -v\n";
     std::cout << "  " << program_name << " -i disk.dd -o output.csv --journal-offset 1048576\n";
     std::cout << "  " << program_name << " -i evidence.E01 -o filtered.csv --start-seq 100 --end-seq 200\n";
+    std::cout << "  " << program_name << " -i evidence.E01 -o live.csv --walk log+stale\n";
+    std::cout << "  " << program_name << " -i evidence.E01 -o output.csv --index evidence.jvidx\n";
+    std::cout << "  " << program_name << " -i /mnt/nas/evidence.E01 -o output.csv --journal-cache evidence.jvcache\n";
+    std::cout << "  " << program_name << " -i evidence.E01 --query-path /etc/passwd --index evidence.jvidx\n";
+    std::cout << "  " << program_name << " -i evidence.E01 -o deleted.csv --walk log+stale --recover-deleted\n";
     std::cout << "  " << program_name << " -i starkskunk5.E01 -o partition6.csv --partition-offset 227328\n";
     std::cout << "  " << program_name << " -i starkskunk5.E01 -o partition6.csv --partition-offset-bytes 116391936\n";
 }
@@ -43,6 +75,11 @@ int main(int argc, char* argv[]) {
     std::string image_type = "auto";
     bool verbose = false;
     bool no_header = false;
+    bool recover_deleted = false;
+    bool suppress_revoked = false;
+    bool deferred_paths = false;
+    bool seed_tree = false;
+    std::string seed_cache_path;
     long journal_offset = -1;
     long journal_size = -1;
     long partition_offset_sectors = -1;
@@ -50,6 +87,19 @@ int main(int argc, char* argv[]) {
     int sector_size = 512;
     int start_seq = -1;
     int end_seq = -1;
+    JournalWalkMode walk_mode = JournalWalkMode::LINEAR_SCAN;
+    bool walk_mode_set = false;
+    long query_inode = -1;
+    long long query_block = -1;
+    std::string query_path;
+    std::string index_path;
+    std::string cache_path;
+    std::string replay_path;
+    std::string overlay_path;
+    int replay_through = -1;
+    long long extract_block = -1;
+    int as_of = -1;
+    std::string extract_out;
 
     // Long options
     static struct option long_options[] = {
@@ -66,6 +116,23 @@ int main(int argc, char* argv[]) {
         {"sector-size", required_argument, 0, 0},
         {"start-seq", required_argument, 0, 0},
         {"end-seq", required_argument, 0, 0},
+        {"walk", required_argument, 0, 0},
+        {"index", required_argument, 0, 0},
+        {"journal-cache", required_argument, 0, 0},
+        {"query-inode", required_argument, 0, 0},
+        {"query-block", required_argument, 0, 0},
+        {"query-path", required_argument, 0, 0},
+        {"recover-deleted", no_argument, 0, 0},
+        {"suppress-revoked", no_argument, 0, 0},
+        {"deferred-paths", no_argument, 0, 0},
+        {"seed-tree", no_argument, 0, 0},
+        {"seed-cache", required_argument, 0, 0},
+        {"replay", required_argument, 0, 0},
+        {"replay-through", required_argument, 0, 0},
+        {"overlay", required_argument, 0, 0},
+        {"extract-block", required_argument, 0, 0},
+        {"as-of", required_argument, 0, 0},
+        {"extract-out", required_argument, 0, 0},
         {"no-header", no_argument, 0, 0},
         {0, 0, 0, 0}
     };
@@ -108,6 +175,52 @@ int main(int argc, char* argv[]) {
                     start_seq = std::stoi(optarg);
                 } else if (strcmp(long_options[option_index].name, "end-seq") == 0) {
                     end_seq = std::stoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "walk") == 0) {
+                    std::string mode = optarg;
+                    if (mode == "scan") {
+                        walk_mode = JournalWalkMode::LINEAR_SCAN;
+                    } else if (mode == "log") {
+                        walk_mode = JournalWalkMode::LOG_ORDER;
+                    } else if (mode == "log+stale") {
+                        walk_mode = JournalWalkMode::LOG_ORDER_STALE;
+                    } else {
+                        std::cerr << "Error: Invalid walk mode. Must be scan, log, or log+stale.\n";
+                        return 1;
+                    }
+                    walk_mode_set = true;
+                } else if (strcmp(long_options[option_index].name, "index") == 0) {
+                    index_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "journal-cache") == 0) {
+                    cache_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "query-inode") == 0) {
+                    query_inode = std::stol(optarg);
+                } else if (strcmp(long_options[option_index].name, "query-block") == 0) {
+                    query_block = std::stoll(optarg);
+                } else if (strcmp(long_options[option_index].name, "query-path") == 0) {
+                    query_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "recover-deleted") == 0) {
+                    recover_deleted = true;
+                } else if (strcmp(long_options[option_index].name, "suppress-revoked") == 0) {
+                    suppress_revoked = true;
+                } else if (strcmp(long_options[option_index].name, "deferred-paths") == 0) {
+                    deferred_paths = true;
+                } else if (strcmp(long_options[option_index].name, "seed-tree") == 0) {
+                    seed_tree = true;
+                } else if (strcmp(long_options[option_index].name, "seed-cache") == 0) {
+                    seed_cache_path = optarg;
+                    seed_tree = true;
+                } else if (strcmp(long_options[option_index].name, "replay") == 0) {
+                    replay_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "replay-through") == 0) {
+                    replay_through = std::stoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "overlay") == 0) {
+                    overlay_path = optarg;
+                } else if (strcmp(long_options[option_index].name, "extract-block") == 0) {
+                    extract_block = std::stoll(optarg);
+                } else if (strcmp(long_options[option_index].name, "as-of") == 0) {
+                    as_of = std::stoi(optarg);
+                } else if (strcmp(long_options[option_index].name, "extract-out") == 0) {
+                    extract_out = optarg;
                 } else if (strcmp(long_options[option_index].name, "no-header") == 0) {
                     no_header = true;
                 }
@@ -120,8 +233,46 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    // Validate required arguments
-    if (input_image.empty() || output_csv.empty()) {
+    // Validate required arguments (point queries print to the console, so -o is optional there)
+    int query_count = (query_inode >= 0) + (query_block >= 0) + !query_path.empty();
+    bool query_mode = query_count > 0;
+    if (query_count > 1) {
+        std::cerr << "Error: Only one of --query-inode, --query-block and --query-path can be given.\n";
+        return 1;
+    }
+    // A replay writes the overlay, so -o is optional there too
+    bool replay_mode = !replay_path.empty();
+    if (replay_mode && (query_mode || !overlay_path.empty())) {
+        std::cerr << "Error: --replay cannot be combined with point queries or --overlay.\n";
+        return 1;
+    }
+    if (replay_through >= 0 && !replay_mode) {
+        std::cerr << "Error: --replay-through requires --replay.\n";
+        return 1;
+    }
+    if (replay_mode && (start_seq >= 0 || end_seq >= 0)) {
+        std::cerr << "Error: A replay always starts at the journal's s_start; use --replay-through to stop early.\n";
+        return 1;
+    }
+    // Extraction writes the block to its own file, so -o is optional as well
+    bool extract_mode = extract_block >= 0;
+    if (extract_mode && (as_of < 0 || extract_out.empty())) {
+        std::cerr << "Error: --extract-block requires --as-of and --extract-out.\n";
+        return 1;
+    }
+    if (!extract_mode && (as_of >= 0 || !extract_out.empty())) {
+        std::cerr << "Error: --as-of and --extract-out require --extract-block.\n";
+        return 1;
+    }
+    if (extract_mode && (query_mode || replay_mode)) {
+        std::cerr << "Error: --extract-block cannot be combined with point queries or --replay.\n";
+        return 1;
+    }
+    if (extract_mode && (start_seq >= 0 || end_seq >= 0)) {
+        std::cerr << "Error: --extract-block needs the whole version history; use --as-of instead of --start-seq/--end-seq.\n";
+        return 1;
+    }
+    if (input_image.empty() || (output_csv.empty() && !query_mode && !replay_mode && !extract_mode)) {
         std::cerr << "Error: Both input image (-i) and output CSV (-o) are required.\n";
         print_usage(argv[0]);
         return 1;
@@ -177,6 +328,8 @@ int main(int argc, char* argv[]) {
         ImageHandler image_handler;
         JournalParser journal_parser;
         CSVExporter csv_exporter;
+        JournalIndex journal_index;
+        csv_exporter.setPathTrie(&journal_parser.getPathTrie());
 
         // Open image
         if (verbose) std::cout << "Opening image file...\n";
@@ -191,6 +344,17 @@ int main(int argc, char* argv[]) {
             if (verbose) std::cout << "Applied partition offset: " << final_partition_offset << " bytes\n";
         }
 
+        // Read the journal and filesystem metadata from a previous extraction
+        bool cache_attached = false;
+        if (!cache_path.empty()) {
+            cache_attached = image_handler.attachJournalCache(cache_path);
+        }
+
+        // Serve replayed blocks over the image, so everything below sees the replayed filesystem
+        if (!overlay_path.empty() && !image_handler.attachOverlay(overlay_path)) {
+            return 1;
+        }
+
         // Locate journal
         if (verbose) std::cout << "Locating journal...\n";
         if (!image_handler.locateJournal(journal_offset, journal_size, verbose)) {
@@ -198,10 +362,193 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
+        // First run: extract the located journal, then read from the local copy
+        if (!cache_path.empty() && !cache_attached) {
+            if (!image_handler.createJournalCache(cache_path) ||
+                !image_handler.attachJournalCache(cache_path)) {
+                std::cerr << "Warning: Continuing without journal cache: " << cache_path << "\n";
+            }
+        }
+
+        // Load or prepare the sidecar index
+        bool index_loaded = false;
+        if (!index_path.empty()) {
+            JournalIndexKey index_key;
+            index_key.image_fingerprint = image_handler.getImageFingerprint();
+            index_key.partition_offset = image_handler.getPartitionOffset();
+            index_key.journal_offset = image_handler.getJournalOffset();
+            
+            index_loaded = journal_index.load(index_path, index_key);
+            if (index_loaded) {
+                if (verbose) std::cout << "Loaded journal index: " << index_path << "\n";
+                journal_parser.setJournalIndex(&journal_index);
+            } else if (query_mode) {
+                // A point query reads too little of the journal to build an index from
+                std::cerr << "Warning: No usable index at " << index_path << ", querying without it.\n";
+            } else {
+                journal_index.reset(index_key);
+                // Index entries need log positions, which only the log walk provides
+                if (walk_mode == JournalWalkMode::LINEAR_SCAN) {
+                    walk_mode = JournalWalkMode::LOG_ORDER_STALE;
+                    if (verbose) std::cout << "Building index with --walk log+stale\n";
+                }
+                journal_parser.setJournalIndex(&journal_index);
+            }
+        }
+
+        // Group layout of the filesystem, used for real inode numbers and block locations
+        ExtFilesystem filesystem;
+        bool fs_loaded = filesystem.load(image_handler);
+        if (fs_loaded) {
+            journal_parser.setFilesystem(&filesystem);
+            if (verbose) {
+                std::cout << "Filesystem geometry: " << filesystem.getGroupCount() << " block groups, "
+                          << filesystem.getRegions().size() << " metadata regions\n";
+            }
+        } else {
+            std::cerr << "Warning: Filesystem geometry unavailable, inode numbers will be relative to each block.\n";
+        }
+
+        // Names of the on-disk directory tree, walked once and then reused from the .jvtree file
+        DirectorySeed directory_seed;
+        if (seed_tree && !fs_loaded) {
+            std::cerr << "Warning: Directory tree not seeded, the filesystem superblock is unreadable.\n";
+        } else if (seed_tree) {
+            DirectorySeedKey seed_key;
+            seed_key.superblock_fingerprint = image_handler.getSuperblockFingerprint();
+            seed_key.partition_offset = image_handler.getPartitionOffset();
+            seed_key.overlay_sequence = image_handler.getOverlaySequence();
+
+            bool seed_ready = !seed_cache_path.empty() && directory_seed.load(seed_cache_path, seed_key);
+            if (seed_ready) {
+                if (verbose) std::cout << "Loaded directory tree: " << seed_cache_path << "\n";
+            } else {
+                seed_ready = directory_seed.build(image_handler, filesystem, seed_key);
+                if (seed_ready && !seed_cache_path.empty() && !directory_seed.write(seed_cache_path)) {
+                    std::cerr << "Warning: Failed to write directory tree: " << seed_cache_path << "\n";
+                }
+            }
+            if (seed_ready) {
+                journal_parser.setDirectorySeed(&directory_seed);
+            } else {
+                std::cerr << "Warning: Continuing without the on-disk directory tree.\n";
+            }
+        }
+
+        // Resolve a point query to the fs block(s) to read from the journal
+        JournalQuery query;
+        if (query_mode) {
+            if (query_block >= 0) {
+                uint32_t block_size = fs_loaded ? filesystem.getBlockSize() : image_handler.getFilesystemBlockSize();
+                query.setBlock(static_cast<uint64_t>(query_block), block_size > 0 ? block_size : 4096);
+            } else if (!fs_loaded) {
+                std::cerr << "Error: Inode and path queries need a readable filesystem superblock.\n";
+                return 1;
+            } else if (query_inode >= 0) {
+                if (!query.setInode(filesystem, static_cast<uint32_t>(query_inode))) {
+                    return 1;
+                }
+            } else if (!query.setPath(image_handler, filesystem, query_path)) {
+                return 1;
+            }
+            
+            journal_parser.setQueryBlocks(query.getTargetBlocks());
+            // Stale copies are part of an object's history
+            if (!walk_mode_set) {
+                walk_mode = JournalWalkMode::LOG_ORDER_STALE;
+            }
+        }
+
+        // jbd2 replays the live log only, which the linear scan cannot tell apart
+        if (replay_mode) {
+            if (walk_mode == JournalWalkMode::LINEAR_SCAN) {
+                if (walk_mode_set) {
+                    std::cerr << "Warning: --replay follows the log, ignoring --walk scan.\n";
+                }
+                walk_mode = JournalWalkMode::LOG_ORDER;
+            }
+            journal_parser.setRecordReplay(true);
+            end_seq = replay_through;
+        }
+
+        // Older laps of the log hold earlier versions of the block
+        if (extract_mode && !walk_mode_set) {
+            walk_mode = JournalWalkMode::LOG_ORDER_STALE;
+        }
+
         // Parse journal
         if (verbose) std::cout << "Parsing journal transactions...\n";
+        journal_parser.setWalkMode(walk_mode);
+        journal_parser.setRecoverDeleted(recover_deleted);
+        journal_parser.setSuppressRevoked(suppress_revoked);
+        journal_parser.setDeferredPaths(deferred_paths);
         auto transactions = journal_parser.parseJournal(image_handler, start_seq, end_seq, verbose);
         
+        // Persist a freshly built index, but only when it covers the whole journal
+        if (!index_path.empty() && !index_loaded && !query_mode) {
+            if (start_seq >= 0 || end_seq >= 0) {
+                std::cerr << "Warning: Index not written because a sequence range was requested.\n";
+            } else if (!journal_index.write(index_path)) {
+                std::cerr << "Warning: Failed to write journal index: " << index_path << "\n";
+            }
+        }
+        
+        if (query_mode) {
+            query.printHistory(image_handler, journal_parser.getQueryVersions());
+            
+            if (!output_csv.empty() &&
+                !csv_exporter.exportToCSV(query.filterRows(transactions), output_csv, !no_header)) {
+                std::cerr << "Error: Failed to export CSV file: " << output_csv << "\n";
+                return 1;
+            }
+            return 0;
+        }
+        
+        if (replay_mode) {
+            uint32_t block_size = fs_loaded ? filesystem.getBlockSize() : image_handler.getFilesystemBlockSize();
+            if (block_size == 0) {
+                std::cerr << "Error: Replay needs the filesystem block size from the superblock.\n";
+                return 1;
+            }
+            if (!ReplayOverlay::create(image_handler, journal_parser.getReplayBlocks(), block_size,
+                                       journal_parser.getReplaySequence(), replay_path)) {
+                return 1;
+            }
+            if (output_csv.empty()) {
+                return 0;
+            }
+        }
+        
+        if (extract_mode) {
+            std::vector<char> data;
+            BlockCopy source = BlockCopy();
+            bool journaled = false;
+            if (!journal_parser.readBlockAsOf(image_handler, static_cast<uint64_t>(extract_block),
+                                              static_cast<uint32_t>(as_of), data, source, journaled)) {
+                std::cerr << "Error: Failed to read fs block " << extract_block << "\n";
+                return 1;
+            }
+            
+            std::ofstream out(extract_out, std::ios::binary | std::ios::trunc);
+            out.write(data.data(), data.size());
+            if (!out.good()) {
+                std::cerr << "Error: Failed writing extracted block: " << extract_out << "\n";
+                return 1;
+            }
+            
+            std::cout << "fs block " << extract_block << " as of sequence " << as_of << ": ";
+            if (journaled) {
+                std::cout << "journaled copy from transaction " << source.sequence
+                          << (source.stale ? " [stale]" : "") << " (journal block " << source.journal_block << ")";
+            } else {
+                std::cout << "not journaled at or before this sequence, read from the image";
+            }
+            std::cout << ", written to " << extract_out << "\n";
+            if (output_csv.empty()) {
+                return 0;
+            }
+        }
+        
         if (transactions.empty()) {
             std::cerr << "Warning: No journal transactions found.\n";
         } else {
@@ -0,0 +1,62 @@
+#include "path_trie.h"
+#include <functional>
+
+PathTrie::PathTrie() {
+    nodes.push_back({NO_PATH, 0, 0});
+    nodes.push_back({NO_PATH, 0, 0});   // ROOT
+}
+
+uint64_t PathTrie::childKey(uint32_t parent, std::string_view name) {
+    uint64_t hash = std::hash<std::string_view>()(name);
+    return hash ^ (static_cast<uint64_t>(parent) * 0x9E3779B97F4A7C15ULL);
+}
+
+uint32_t PathTrie::intern(uint32_t parent, std::string_view name) {
+    const uint64_t key = childKey(parent, name);
+    auto range = children.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Node& node = nodes[it->second];
+        if (node.parent == parent && nameOf(node) == name) {
+            return it->second;
+        }
+    }
+
+    uint32_t id = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({parent, static_cast<uint32_t>(names.size()), static_cast<uint32_t>(name.size())});
+    names.append(name.data(), name.size());
+    children.emplace(key, id);
+    return id;
+}
+
+std::string PathTrie::materialize(uint32_t id) const {
+    std::string path;
+    appendPath(id, path);
+    return path;
+}
+
+// Parents always have lower ids than their children, so the walk up terminates
+void PathTrie::appendPath(uint32_t id, std::string& out) const {
+    if (id == NO_PATH || id >= nodes.size()) {
+        return;
+    }
+    if (id == ROOT) {
+        out += '/';
+        return;
+    }
+
+    size_t length = 0;
+    for (uint32_t current = id; current != ROOT && current != NO_PATH; current = nodes[current].parent) {
+        length += 1 + nodes[current].name_length;
+    }
+
+    // Fill from the last component backwards
+    size_t start = out.size();
+    out.resize(start + length);
+    size_t position = start + length;
+    for (uint32_t current = id; current != ROOT && current != NO_PATH; current = nodes[current].parent) {
+        const Node& node = nodes[current];
+        position -= node.name_length;
+        names.copy(&out[position], node.name_length, node.name_offset);
+        out[--position] = '/';
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef PATH_TRIE_H
+#define PATH_TRIE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// Shared parent-pointer trie of path components. A path is stored once per
+// distinct prefix and referred to by the id of its last component, so each
+// JournalTransaction carries a 4-byte path_id instead of a full path string;
+// the text is only materialized at export. Ids never change once handed out.
+class PathTrie {
+private:
+    struct Node {
+        uint32_t parent;
+        uint32_t name_offset;       // Into names
+        uint32_t name_length;
+    };
+
+    std::vector<Node> nodes;
+    std::string names;                                      // All component names back to back
+    std::unordered_multimap<uint64_t, uint32_t> children;  // hash(parent, name) -> child id
+
+    static uint64_t childKey(uint32_t parent, std::string_view name);
+    std::string_view nameOf(const Node& node) const { return std::string_view(names).substr(node.name_offset, node.name_length); }
+
+public:
+    static const uint32_t NO_PATH = 0;  // Empty full_path
+    static const uint32_t ROOT = 1;     // "/"
+
+    PathTrie();
+
+    // Id of parent/name, adding the component if it is new
+    uint32_t intern(uint32_t parent, std::string_view name);
+
+    // Text of a path id: "" for NO_PATH, "/" for ROOT, "/a/b" otherwise
+    std::string materialize(uint32_t id) const;
+    void appendPath(uint32_t id, std::string& out) const;
+
+    size_t size() const { return nodes.size(); }
+    size_t nameBytes() const { return names.size(); }
+};
+
+#endif // PATH_TRIE_H
@@ -0,0 +1,144 @@
+#include "replay_overlay.h"
+#include "image_handler.h"
+#include "jbd2.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
+
+static const char OVERLAY_MAGIC[8] = {'J', 'V', 'O', 'V', 'R', 'L', 'Y', 0};
+
+ReplayOverlay::ReplayOverlay() : header() {
+}
+
+bool ReplayOverlay::create(ImageHandler& image_handler, const std::vector<ReplayBlock>& blocks,
+                           uint32_t block_size, uint32_t through_sequence, const std::string& path) {
+    ReplayOverlayFileHeader file_header = ReplayOverlayFileHeader();
+    memcpy(file_header.magic, OVERLAY_MAGIC, sizeof(file_header.magic));
+    file_header.version = OVERLAY_VERSION;
+    file_header.block_size = block_size;
+    file_header.block_count = blocks.size();
+    file_header.superblock_fingerprint = image_handler.getSuperblockFingerprint();
+    file_header.partition_offset = image_handler.getPartitionOffset();
+    file_header.through_sequence = through_sequence;
+
+    // Blocks come from the parser sorted by fs block, one copy each
+    std::vector<ReplayOverlayEntry> file_entries(blocks.size());
+    uint64_t file_offset = sizeof(ReplayOverlayFileHeader) + blocks.size() * sizeof(ReplayOverlayEntry);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        file_entries[i].fs_block = blocks[i].fs_block;
+        file_entries[i].file_offset = file_offset;
+        file_offset += block_size;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot create replay overlay file: " << path << std::endl;
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+    out.write(reinterpret_cast<const char*>(file_entries.data()), file_entries.size() * sizeof(ReplayOverlayEntry));
+
+    std::vector<char> data(block_size);
+    for (const auto& block : blocks) {
+        long journal_offset = static_cast<long>(block.journal_block) * static_cast<long>(block_size);
+        if (!image_handler.readJournalBytes(journal_offset, data.data(), block_size)) {
+            std::cerr << "Error: Failed to read journal block " << block.journal_block
+                      << " while replaying fs block " << block.fs_block << std::endl;
+            out.close();
+            std::remove(path.c_str());
+            return false;
+        }
+        if (block.escaped) {
+            restoreEscapedMagic(data.data());
+        }
+        out.write(data.data(), block_size);
+    }
+
+    // Close first so a failed final flush counts too; never leave a truncated file behind
+    out.close();
+    if (out.fail()) {
+        std::cerr << "Error: Failed writing replay overlay file: " << path << std::endl;
+        std::remove(path.c_str());
+        return false;
+    }
+
+    std::cout << "Replayed " << blocks.size() << " blocks through sequence " << through_sequence
+              << " into overlay " << path << std::endl;
+    return true;
+}
+
+bool ReplayOverlay::open(const std::string& path, uint64_t superblock_fingerprint, int64_t partition_offset) {
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open replay overlay file: " << path << std::endl;
+        return false;
+    }
+
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || memcmp(header.magic, OVERLAY_MAGIC, sizeof(OVERLAY_MAGIC)) != 0 ||
+        header.version != OVERLAY_VERSION || header.block_size == 0) {
+        std::cerr << "Error: " << path << " is not a compatible replay overlay" << std::endl;
+        file.close();
+        return false;
+    }
+
+    if (header.superblock_fingerprint != superblock_fingerprint || header.partition_offset != partition_offset) {
+        std::cerr << "Error: Replay overlay " << path << " was built for a different image" << std::endl;
+        file.close();
+        return false;
+    }
+
+    // The entries must be sorted and their blocks must lie inside the file
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(file.tellg());
+    uint64_t table_end = sizeof(header) + header.block_count * sizeof(ReplayOverlayEntry);
+    bool valid = file.good() && header.block_count <= file_size / sizeof(ReplayOverlayEntry) && table_end <= file_size;
+    if (valid) {
+        entries.resize(header.block_count);
+        file.seekg(sizeof(header));
+        file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(ReplayOverlayEntry));
+        valid = file.good();
+    }
+    for (size_t i = 0; valid && i < entries.size(); ++i) {
+        valid = entries[i].file_offset >= table_end && entries[i].file_offset <= file_size &&
+                header.block_size <= file_size - entries[i].file_offset &&
+                (i == 0 || entries[i].fs_block > entries[i - 1].fs_block);
+    }
+    if (!valid) {
+        std::cerr << "Error: Replay overlay " << path << " is corrupt" << std::endl;
+        entries.clear();
+        file.close();
+        return false;
+    }
+
+    std::cout << "Using replay overlay " << path << " (" << entries.size() << " blocks through sequence "
+              << header.through_sequence << ")" << std::endl;
+    return true;
+}
+
+bool ReplayOverlay::overlaps(long offset, size_t size) const {
+    if (entries.empty() || offset < 0 || size == 0) {
+        return false;
+    }
+    uint64_t first = static_cast<uint64_t>(offset) / header.block_size;
+    uint64_t last = (static_cast<uint64_t>(offset) + size - 1) / header.block_size;
+
+    auto it = std::lower_bound(entries.begin(), entries.end(), first,
+                               [](const ReplayOverlayEntry& e, uint64_t value) { return e.fs_block < value; });
+    return it != entries.end() && it->fs_block <= last;
+}
+
+bool ReplayOverlay::readBlock(uint64_t fs_block, size_t within, char* buffer, size_t size) {
+    auto it = std::lower_bound(entries.begin(), entries.end(), fs_block,
+                               [](const ReplayOverlayEntry& e, uint64_t value) { return e.fs_block < value; });
+    if (it == entries.end() || it->fs_block != fs_block || within + size > header.block_size) {
+        return false;
+    }
+
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(it->file_offset + within));
+    file.read(buffer, size);
+    return file.good() && file.gcount() == static_cast<std::streamsize>(size);
+}
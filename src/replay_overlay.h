@@ -0,0 +1,71 @@
+#ifndef REPLAY_OVERLAY_H
+#define REPLAY_OVERLAY_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+class ImageHandler;
+
+// Journaled copy of an fs block selected for replay: the newest committed,
+// non-revoked copy of the block at or before the replay sequence
+struct ReplayBlock {
+    uint64_t fs_block;
+    uint32_t sequence;              // Transaction that journaled the copy
+    uint32_t journal_block;         // Log block holding the copy
+    bool escaped;                   // JBD2_FLAG_ESCAPE: the leading magic was zeroed
+};
+
+// On-disk layout of an overlay file: the header, then block_count
+// ReplayOverlayEntry records sorted by fs block, then the blocks back to back.
+struct ReplayOverlayFileHeader {
+    char magic[8];                  // "JVOVRLY\0"
+    uint32_t version;
+    uint32_t block_size;
+    uint64_t block_count;
+    uint64_t superblock_fingerprint; // ImageHandler::getSuperblockFingerprint() of the base image
+    int64_t partition_offset;       // Partition offset in bytes
+    uint32_t through_sequence;      // Last transaction replayed
+    uint32_t reserved;
+};
+
+struct ReplayOverlayEntry {
+    uint64_t fs_block;
+    uint64_t file_offset;           // Offset of the block in the overlay file
+};
+
+// Copy-on-write view of a replayed journal. Only the replayed fs blocks are
+// stored; attached to an ImageHandler, reads of those blocks come from the
+// overlay and everything else from the untouched base image.
+class ReplayOverlay {
+private:
+    static const uint32_t OVERLAY_VERSION = 1;
+
+    ReplayOverlayFileHeader header;
+    std::vector<ReplayOverlayEntry> entries;   // Sorted by fs_block
+    std::ifstream file;
+
+public:
+    ReplayOverlay();
+
+    // Write the journaled copies of the replay blocks into a new overlay file
+    static bool create(ImageHandler& image_handler, const std::vector<ReplayBlock>& blocks,
+                       uint32_t block_size, uint32_t through_sequence, const std::string& path);
+
+    // Open an existing overlay; fails if it was built from a different image
+    bool open(const std::string& path, uint64_t superblock_fingerprint, int64_t partition_offset);
+
+    // True if any block of the partition-relative range [offset, offset + size) is replayed
+    bool overlaps(long offset, size_t size) const;
+
+    // Read part of a replayed block; false if the block is not in the overlay
+    bool readBlock(uint64_t fs_block, size_t within, char* buffer, size_t size);
+
+    uint32_t getBlockSize() const { return header.block_size; }
+    uint32_t getThroughSequence() const { return header.through_sequence; }
+    size_t getBlockCount() const { return entries.size(); }
+};
+
+#endif // REPLAY_OVERLAY_H